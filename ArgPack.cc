@@ -5,6 +5,11 @@
 #include <functional>
 #include <iomanip>
 #include <map>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
 
 #include "RMath.h"
 #include "RPair.h"
@@ -16,18 +21,366 @@
 #include "TGraph.h"
 #include "RGen.h"
 #include "DBase.h"
+#include "RThread.h"
+#include "RCounter.h"
 
 using namespace std;
 using namespace rstd;
 
 /*###########################################################################*/
 // Private
-ArgPack * ArgPack::def_ap_ = 0;
+__thread ArgPack * ArgPack::def_ap_ = 0;
+
+namespace {
+// Bytes reserved for the @HYPERPERIOD header under stream_write.
+const string::size_type HEADER_SPACE = 40;
+
+/*===========================================================================*/
+bool read_file(const string & file_name, string & text) {
+	ifstream is(file_name.c_str());
+	if (! is)
+		return false;
+
+	ostringstream os;
+	os << is.rdbuf();
+	text = os.str();
+	return true;
+}
+
+/*===========================================================================*/
+/* Reads one command, joining lines ending in \ and skipping comments.  False
+at the end of the input. */
+bool read_command(istream & is, int & line, string & s) {
+	s.clear();
+
+	while (1) {
+		string line_buf;
+		if (! getline(is, line_buf))
+			return false;
+
+		line++;
+
+		RVector<string> tokenized = tokenize(line_buf);
+
+		if (! tokenized.empty() &&
+			tokenized[0][0] != '#')
+		{
+			s += line_buf;
+
+			if (! s.empty() && s[s.size() - 1] == '\\')
+				s.erase(s.size() - 1);
+			else
+				return true;
+		}
+	}
+}
+
+/*===========================================================================*/
+// The values of a sweep: lo..hi, or a comma separated list of arguments.
+
+class SweepValues {
+public:
+	SweepValues() : lo_(0), hi_(-1), list_() {}
+
+	bool parse(const string & s);
+	long size() const { return list_.empty() ? hi_ - lo_ + 1 : list_.size(); }
+	string operator[](long i) const;
+
+private:
+		long lo_;
+		long hi_;
+		RVector<string> list_;
+};
+
+/*===========================================================================*/
+bool SweepValues::parse(const string & s) {
+	RVector<string> vec = tokenize(s);
+	if (vec.size() == 1) {
+		const string::size_type dots = vec[0].find("..");
+		if (dots != string::npos) {
+			if (! dots || dots + 2 == vec[0].size())
+				return false;
+
+			lo_ = Conv(vec[0].substr(0, dots));
+			hi_ = Conv(vec[0].substr(dots + 2));
+			return lo_ <= hi_;
+		}
+	}
+
+	list_ = tokenize(s, ",");
+	MAP(x, list_.size()) {
+		if (tokenize(list_[x]).empty())
+			return false;
+	}
+
+	return ! list_.empty();
+}
+
+/*===========================================================================*/
+string SweepValues::operator[](long i) const {
+	RASSERT(i >= 0 && i < size());
+	return list_.empty() ? to_string(lo_ + i) : list_[i];
+}
+
+/*===========================================================================*/
+// Records the resource use of a command as it goes out of scope.
+
+class StatRecorder {
+public:
+	StatRecorder(RVector<ArgStat> & stats, const string & command, int line) :
+		stats_(stats), start_(ArgStat::now())
+	{
+		start_.command = command;
+		start_.line = line;
+	}
+
+	~StatRecorder() { stats_.push_back(ArgStat::now().since(start_)); }
+
+private:
+		RVector<ArgStat> & stats_;
+		ArgStat start_;
+};
+
+/*===========================================================================*/
+// Commands which generate data or open the data file.
+
+bool writes_data(const string & command) {
+	return command == "note_write" || command == "eps_write" ||
+		command == "vcg_write" || command == "tg_write" ||
+		command == "tgb_write" || command == "pe_write" ||
+		command == "trans_write" || command == "misc_write" ||
+		command == "opt_write" || command == "stream_write";
+}
+
+/*===========================================================================*/
+void print_json_string(ostream & os, const string & s) {
+	os << '"';
+	MAP(x, s.size()) {
+		if (s[x] == '"' || s[x] == '\\')
+			os << '\\';
+
+		os << s[x];
+	}
+
+	os << '"';
+}
+
+/*===========================================================================*/
+/* Writes head over the first space bytes of the file, moving the rest down to
+follow it.  One sequential pass over the file. */
+
+bool fill_header(const string & file_name, const string & head, off_t space) {
+	const int fd = open(file_name.c_str(), O_RDWR);
+	if (fd < 0)
+		return false;
+
+	const ssize_t head_size = head.size();
+	bool ok = pwrite(fd, head.data(), head_size, 0) == head_size;
+
+	RVector<char> buf(1 << 20);
+	off_t from = space;
+	off_t to = head_size;
+	while (ok && from != to) {
+		const ssize_t n = pread(fd, &buf[0], buf.size(), from);
+		if (n <= 0) {
+			ok = ! n && ! ftruncate(fd, to);
+			break;
+		}
+
+		ok = pwrite(fd, &buf[0], n, to) == n;
+		from += n;
+		to += n;
+	}
+
+	return ! close(fd) && ok;
+}
+
+/*===========================================================================*/
+// Runs batch jobs, each with its own generator, options and output buffers.
+
+class BatchRunner {
+public:
+	explicit BatchRunner(const RVector<ArgJob> & job) : job_(job) {}
+
+	void operator()(long i) const {
+		RGen gen;
+		RGenBind bind(gen);
+		ArgPack ap(job_[i]);
+	}
+
+private:
+		const RVector<ArgJob> & job_;
+};
+
+}
 
 /*===========================================================================*/
 // Public
 /*===========================================================================*/
-ArgPack::ArgPack(int argc, char * const argv[]) :
+void ArgPack::run(int argc, char * const argv[]) {
+	if ((argc == 3 || argc == 4) && string(argv[1]) == "-batch") {
+		int threads = 1;
+		if (argc == 4 && (threads = Conv(argv[3])) < 1) {
+			cout << help_;
+			exit(EXIT_FAILURE);
+		}
+
+		batch(argv[2], threads);
+		return;
+	}
+
+	ArgJob job;
+	if (argc == 4 && string(argv[1]) == "-shard") {
+		RVector<string> part = tokenize(argv[2], "/");
+		if (part.size() != 2 ||
+		  (job.shard_cnt = Conv(part[1])) < 1 ||
+		  (job.shard = Conv(part[0])) < 0 || job.shard >= job.shard_cnt)
+		{
+			cout << help_;
+			exit(EXIT_FAILURE);
+		}
+
+		argv += 2;
+		argc -= 2;
+	}
+
+	if (argc != 2) {
+		cout << help_;
+		exit(EXIT_FAILURE);
+	}
+
+	job.base = argv[1];
+	job.opt_file = job.base + ".tgffopt";
+
+	string opt_text;
+	if (! read_file(job.opt_file, opt_text)) {
+		cout << "Unable to open input file.\n";
+		exit(EXIT_FAILURE);
+	}
+
+	job.opt_text = &opt_text;
+
+	RVector<ArgJob> jobs;
+	add_jobs(job, jobs);
+
+// Sweeps use every processor.  A single job runs in this thread.
+	const int threads = max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+	parallel_map(jobs.size(), threads, BatchRunner(jobs));
+}
+
+/*===========================================================================*/
+void ArgPack::batch(const string & job_file, int threads) {
+	ifstream is(job_file.c_str());
+	if (! is) {
+		cout << "Unable to open batch file.\n";
+		exit(EXIT_FAILURE);
+	}
+
+// Each options file is read once, however many jobs use it.
+	map<string, string> opt_text;
+	RVector<ArgJob> job;
+
+	int line = 0;
+	string line_buf;
+	while (getline(is, line_buf)) {
+		line++;
+
+		RVector<string> vec = tokenize(line_buf);
+		if (vec.empty() || vec[0][0] == '#')
+			continue;
+
+		if (vec.size() != 3) {
+			cout << "Parse error on line " << line << " of " << job_file <<
+				".\n";
+			exit(EXIT_FAILURE);
+		}
+
+		ArgJob j;
+		j.opt_file = vec[0];
+		if (vec[1] != "-") {
+			j.seed = Conv(vec[1]);
+			j.has_seed = true;
+		}
+
+		j.base = vec[2];
+
+		map<string, string>::iterator it = opt_text.find(j.opt_file);
+		if (it == opt_text.end()) {
+			it = opt_text.insert(make_pair(j.opt_file, string())).first;
+			if (! read_file(j.opt_file, it->second)) {
+				cout << "Unable to open input file " << j.opt_file << ".\n";
+				exit(EXIT_FAILURE);
+			}
+		}
+
+		j.opt_text = &it->second;
+		add_jobs(j, job);
+	}
+
+	parallel_map(job.size(), threads, BatchRunner(job));
+}
+
+/*===========================================================================*/
+ArgStat ArgStat::now() {
+	ArgStat s;
+
+	timeval tv;
+	gettimeofday(&tv, 0);
+	s.wall = tv.tv_sec + tv.tv_usec * 1e-6;
+
+	rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	s.cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6 +
+		ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+	s.max_rss = ru.ru_maxrss;
+
+	const RVector<RCounter *> & counter = RCounter::all();
+	MAP(x, counter.size()) {
+		s.counter.push_back(counter[x]->count());
+	}
+
+	return s;
+}
+
+/*===========================================================================*/
+ArgStat ArgStat::since(const ArgStat & start) const {
+	ArgStat s(*this);
+	s.command = start.command;
+	s.line = start.line;
+	s.wall -= start.wall;
+	s.cpu -= start.cpu;
+
+	MAP(x, s.counter.size()) {
+		s.counter[x] -= start.counter[x];
+	}
+
+	return s;
+}
+
+/*===========================================================================*/
+void ArgStat::print_to(ostream & os) const {
+	os << "{";
+	if (line) {
+		os << "\"line\": " << line << ", \"command\": ";
+		print_json_string(os, command);
+		os << ", ";
+	}
+
+	os << "\"wall_s\": " << wall << ", \"cpu_s\": " << cpu <<
+		", \"max_rss_kb\": " << max_rss << ", \"counters\": {";
+
+	const RVector<RCounter *> & name = RCounter::all();
+	MAP(x, counter.size()) {
+		os << (x ? ", " : "");
+		print_json_string(os, name[x]->name());
+		os << ": " << counter[x];
+	}
+
+	os << "}}";
+}
+
+/*===========================================================================*/
+ArgPack::ArgPack(const ArgJob & job) :
 	tg_label("TASK_GRAPH"),
 	tg_cnt(3),
 	vertex_time(100),
@@ -48,7 +401,12 @@ ArgPack::ArgPack(int argc, char * const argv[]) :
 	prob_multi_start_nodes(0.0),
 	start_node_av(2),
 	start_node_mul(1),
+	gen_compat(true),
+	thread_cnt(0),
+	rng_engine(RGen::MARSAGLIA),
+	stream_write(false),
 	p_laxity(1.0),
+	period_grain(0.0),
 	p_greater_deadline(false),
 	prob_hard_deadline(1.0),
 	soft_deadline_mul(1.0),
@@ -77,7 +435,7 @@ ArgPack::ArgPack(int argc, char * const argv[]) :
 	series_wid_mul(1),
 	series_local_xover (0),
 	series_global_xover (0),
-	seed(0),
+	seed(job.has_seed ? job.seed : 0),
 	misc_type_cnt(0),
 	prob_periodic(1.0),
 	aperiodic_min_used (false),
@@ -87,10 +445,25 @@ ArgPack::ArgPack(int argc, char * const argv[]) :
 	eps_file_name("tgff.eps"),
 	vcg_file_name("tgff.vcg"),
 	opt_file_name("tgff.tgffopt"),
+	tgb_file_name("tgff.tgffb"),
+	stats_file_name("tgff.json"),
 	data_out_(),
+	stream_out_(),
 	eps_out_(),
 	vcg_out_(),
-	opt_in_()
+	opt_text_(job.opt_text),
+	opt_in_(*job.opt_text),
+	tgb_out_(),
+	fixed_seed_(job.has_seed),
+	sweep_rem_(job.sweep),
+	write_(! job.base.empty()),
+	shard_(job.shard),
+	shard_cnt_(job.shard_cnt),
+	graph_total_(job.shard_cnt > 1 ? graph_cnt(job) : 0),
+	graph_number_(0),
+	stats_write_(false),
+	start_(ArgStat::now()),
+	stats_()
 {
 	RASSERT(! def_ap_);
 	def_ap_ = this;
@@ -111,21 +484,21 @@ ArgPack::ArgPack(int argc, char * const argv[]) :
 	type_jitter[0] = 0.5;
 	type_round[0] = 0.0;
 
-	if (argc != 2) {
-		cout << help_;
-		exit(EXIT_FAILURE);
+// Only set the options, for programs linking libtgff.a.
+	if (job.base.empty()) {
+		parse();
+		return;
 	}
 
-	data_file_name = string(argv[1]) + ".tgff";
-	eps_file_name = string(argv[1]) + ".eps";
-	vcg_file_name = string(argv[1]) + ".vcg";
-	opt_file_name = string(argv[1]) + ".tgffopt";
+	const string base = shard_cnt_ > 1 ?
+		job.base + "." + to_string(shard_) : job.base;
 
-	opt_in_.open(opt_file_name.c_str());
-	if (! opt_in_) {
-		cout << "Unable to open input file.\n";
-		exit(EXIT_FAILURE);
-	}
+	data_file_name = base + ".tgff";
+	eps_file_name = base + ".eps";
+	vcg_file_name = base + ".vcg";
+	opt_file_name = job.opt_file;
+	tgb_file_name = base + ".tgffb";
+	stats_file_name = base + ".json";
 
 	eps_out_.open(eps_file_name.c_str());
 	if (! eps_out_) {
@@ -144,22 +517,60 @@ ArgPack::ArgPack(int argc, char * const argv[]) :
 
 	double h_period = parse();
 
+	if (tgb_out_.is_open()) {
+		tgb_out_.close(h_period);
+	}
+
+// The first shard has the header and the last the end of the file.
+	const bool has_end = shard_of(graph_total_) == shard_;
+
+	if (stream_out_.is_open()) {
+		if (has_end)
+			stream_out_ << endl;
+
+		if (shard_) {
+			vcg_out_ << "\n } \n";
+			write_stats();
+			return;
+		}
+
+// Fill in the space reserved by open_stream_out(), as the buffered output
+// would have it.
+		ostringstream header;
+		if (h_period > 0.0) {
+			header << "@HYPERPERIOD " << h_period << "\n\n";
+		}
+
+		RASSERT(header.str().size() <= HEADER_SPACE);
+		stream_out_.close();
+		if (! fill_header(data_file_name, header.str(), HEADER_SPACE)) {
+			cout << "Unable to write TGFF output file.\n";
+			exit(EXIT_FAILURE);
+		}
+
+		vcg_out_ << "\n } \n";
+		write_stats();
+		return;
+	}
+
 	ofstream real_out(data_file_name.c_str());
 	if (! real_out) {
 		cout << "Unable to open TGFF output files.\n";
 		exit(EXIT_FAILURE);
 	}
 
-	if (h_period > 0.0) {
+	if (! shard_ && h_period > 0.0) {
 		real_out << "@HYPERPERIOD " << h_period << "\n\n";
 	}
 
-	data_out_ << endl;
+	if (has_end)
+		data_out_ << endl;
 
 // Copy the output buffer to the real output file.
 	real_out << data_out_.str();
 
 	vcg_out_ << "\n } \n";
+	write_stats();
 }
 
 /*===========================================================================*/
@@ -170,6 +581,134 @@ ArgPack::~ArgPack() {
 
 /*===========================================================================*/
 // Private
+/*===========================================================================*/
+ostream &
+ArgPack::data_out() {
+	if (stream_out_.is_open())
+		return stream_out_;
+
+	return data_out_;
+}
+
+/*===========================================================================*/
+void ArgPack::open_stream_out() {
+	stream_out_.open(data_file_name.c_str());
+	if (! stream_out_) {
+		cout << "Unable to open TGFF output files.\n";
+		exit(EXIT_FAILURE);
+	}
+
+// The hyperperiod is only known at the end, so reserve space for it.
+	if (! shard_)
+		stream_out_ << string(HEADER_SPACE, ' ');
+
+	stream_out_ << data_out_.str();
+	data_out_.str("");
+}
+
+/*===========================================================================*/
+void ArgPack::write_stats() const {
+	if (! stats_write_)
+		return;
+
+	ofstream os(stats_file_name.c_str());
+	if (! os) {
+		cout << "Unable to open stats output file.\n";
+		exit(EXIT_FAILURE);
+	}
+
+	os << "{\"file\": ";
+	print_json_string(os, data_file_name);
+	os << ",\n\"total\": ";
+	ArgStat::now().since(start_).print_to(os);
+	os << ",\n\"commands\": [";
+
+	MAP(x, stats_.size()) {
+		os << (x ? ",\n  " : "\n  ");
+		stats_[x].print_to(os);
+	}
+
+	os << "\n]}\n";
+}
+
+/*===========================================================================*/
+long ArgPack::graph_cnt(const ArgJob & job) {
+	ArgJob count(job);
+	count.base.clear();
+	count.shard_cnt = 1;
+
+	ArgPack ap(count);
+	return ap.graph_total_;
+}
+
+/*===========================================================================*/
+int ArgPack::shard_of(long g) const {
+	if (shard_cnt_ == 1 || ! graph_total_)
+		return 0;
+
+	return static_cast<int>(min<long>(shard_cnt_ - 1,
+		g * shard_cnt_ / graph_total_));
+}
+
+/*===========================================================================*/
+// The first graph of shard, as numbered through the run.
+
+long ArgPack::shard_begin(int shard) const {
+	return (shard * graph_total_ + shard_cnt_ - 1) / shard_cnt_;
+}
+
+/*===========================================================================*/
+void ArgPack::check_shard(int line) const {
+	if (! thread_cnt || task_unique || p_greater_deadline ||
+	  (eps_equal_to<double>()(period_grain, 0.0) && prob_periodic > 0.0))
+	{
+		cout << "Line " << line << ": sharding needs thread_cnt, and " <<
+			"period_grain if any graph is periodic, and neither task_unique " <<
+			"nor period_g_deadline.\n";
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*===========================================================================*/
+void ArgPack::add_jobs(const ArgJob & job, RVector<ArgJob> & jobs) {
+	istringstream is(*job.opt_text);
+	int line = 0;
+	long cnt = 1;
+	bool sweep = false;
+
+	string s;
+	while (read_command(is, line, s)) {
+		if (first_token(s) != "sweep")
+			continue;
+
+		pop_token(s);
+		const string command = first_token(s);
+		pop_token(s);
+
+		SweepValues value;
+		if (command.empty() || command == "sweep" || ! value.parse(s) ||
+			value.size() > LONG_MAX / cnt)
+		{
+			parse_error(line);
+		}
+
+		cnt *= value.size();
+		sweep = true;
+	}
+
+	if (! sweep) {
+		jobs.push_back(job);
+		return;
+	}
+
+	MAP(x, cnt) {
+		ArgJob j(job);
+		j.base = job.base + "-" + to_string(x);
+		j.sweep = x;
+		jobs.push_back(j);
+	}
+}
+
 /*===========================================================================*/
 double
 ArgPack::parse() {
@@ -184,43 +723,46 @@ ArgPack::parse() {
 
 	while (1) {
 		string s;
-		bool wrap = true;
 
 // Get a single command
-		do {
-			string line_buf;
-
-			if (! getline(opt_in_, line_buf)) {
-				if (h_period.size()) {
-					return lcm(h_period);
-				} else {
-					return -1.0;
-				}
-			}
-
-			line++;
-
-			RVector<string> tokenized = tokenize(line_buf);
-			
-			if (! tokenized.empty() &&
-				tokenized[0][0] != '#')
-			{
-				s += line_buf;
-
-				if (! s.empty() && s[s.size() - 1] == '\\')
-					s.erase(s.size() - 1);
-				else
-					wrap = false;
+		if (! read_command(opt_in_, line, s)) {
+			if (h_period.size()) {
+				return lcm(h_period);
+			} else {
+				return -1.0;
 			}
-		} while (wrap);
+		}
 
 		string first = first_token(s);
 		if (first.empty())
 			parse_error(line);
 
-		const string command = first;
+		string command = first;
 		pop_token(s);
 
+// A sweep stands for its command with the value this job picks.
+		if (command == "sweep") {
+			command = first_token(s);
+			pop_token(s);
+
+			SweepValues value;
+			if (command.empty() || command == "sweep" || ! value.parse(s))
+				parse_error(line);
+
+			s = value[sweep_rem_ % value.size()];
+			sweep_rem_ /= value.size();
+		}
+
+// Without output files, write commands only count graphs.
+		if (! write_ && writes_data(command)) {
+			if (command == "tg_write")
+				graph_total_ += tg_cnt;
+
+			continue;
+		}
+
+		StatRecorder stat(stats_, command, line);
+
 		RVector<string> vec = tokenize(s);
 		RVector<string> top_rvec(0);
 		if (! vec.empty())
@@ -304,13 +846,15 @@ ArgPack::parse() {
 						num_com_soln,
 						arc_fill_factor);
 
-			pg.print_to(data_out_);
+			pg.print_to(data_out());
 			return pg.h_period();
 
 		} else if (command == "task_cnt") {
-			if (vec.size() != 2) parse_error(line);
+// The multiplier may be left out, e.g. in sweep task_cnt 10,50,200.
+			if (vec.size() != 1 && vec.size() != 2) parse_error(line);
 			vertex_cnt_av = Conv(vec[0]);
-			vertex_cnt_mul = Conv(vec[1]);
+			if (vec.size() == 2)
+				vertex_cnt_mul = Conv(vec[1]);
 
 			if (vertex_cnt_av - abs(vertex_cnt_mul) < 0) {
 				parse_error(line);
@@ -343,6 +887,46 @@ ArgPack::parse() {
 			start_node_mul = Conv(vec[1]);
 			if (start_node_av < 1) parse_error(line);
 
+		} else if (command == "gen_compat") {
+			if (vec.size() > 1) parse_error(line);
+			if (vec.size())
+				gen_compat = Conv(vec[0]);
+			else
+				gen_compat = true;
+
+		} else if (command == "stream_write") {
+			if (vec.size() > 1) parse_error(line);
+			if (vec.size())
+				stream_write = Conv(vec[0]);
+			else
+				stream_write = true;
+
+			if (stream_write && write_ && ! stream_out_.is_open()) {
+				open_stream_out();
+			} else if (! stream_write && stream_out_.is_open()) {
+				parse_error(line);
+			}
+
+		} else if (command == "thread_cnt") {
+			if (vec.size() != 1 ||
+			  (thread_cnt = Conv(vec[0])) < 0)
+			{
+				parse_error(line);
+			}
+
+		} else if (command == "rng_engine") {
+			if (vec.size() != 1) parse_error(line);
+			if (vec[0] == "marsaglia")
+				rng_engine = RGen::MARSAGLIA;
+			else if (vec[0] == "xoshiro256ss")
+				rng_engine = RGen::XOSHIRO256SS;
+			else if (vec[0] == "philox")
+				rng_engine = RGen::PHILOX4X32;
+			else
+				parse_error(line);
+
+			RGen::gen().set_engine(rng_engine);
+
 		} else if (command == "task_type_cnt") {
 			if (vec.size() != 1 ||
 			  (task_type_cnt = Conv(vec[0])) < 0)
@@ -388,6 +972,13 @@ ArgPack::parse() {
 				parse_error(line);
 			}
 
+		} else if (command == "period_grain") {
+			if (vec.size() != 1 ||
+				(period_grain = Conv(vec[0])) < 0.0)
+			{
+				parse_error(line);
+			}
+
 		} else if (command == "period_g_deadline") {
 			if (vec.size() > 1) parse_error(line);
 			if (vec.size() == 1) {
@@ -521,7 +1112,8 @@ ArgPack::parse() {
 			table_offset[pe_name] = offset;
 		} else if (command == "seed") {
 			if (vec.size() != 1) parse_error(line);
-			seed = Conv(vec[0]);
+			if (! fixed_seed_)
+				seed = Conv(vec[0]);
 
 
 		} else if (command == "gen_series_parallel") {
@@ -574,66 +1166,123 @@ ArgPack::parse() {
 			aperiodic_min_mul = Conv(vec[1]);
 
 
+		} else if (command == "stats_write") {
+			if (! vec.empty()) parse_error(line);
+			stats_write_ = true;
+
 		} else if (command == "note_write") {
-			MAP(x, vec.size())
-				data_out_ << vec[x] << " ";
+			if (writes_here()) {
+				MAP(x, vec.size())
+					data_out() << vec[x] << " ";
 
-			data_out_ << endl;
+				data_out() << endl;
+			}
 
 		} else if (command == "eps_write") {
-			RGen::gen().set_seed(seed);
-			TGraph tg(tg_offset[tg_label]);
-			tg.print_to_ps(eps_out_, eps_file_name);
+			if (! shard_) {
+				RGen::gen().set_seed(seed);
+				TGraph tg(tg_offset[tg_label]);
+				tg.print_to_ps(eps_out_, eps_file_name);
+			}
 
 		} else if (command == "vcg_write") {
-			RGen::gen().set_seed(seed);
-			TGraph tg(tg_offset[tg_label]);
-			tg.print_to_vcg(vcg_out_);
+			if (! shard_) {
+				RGen::gen().set_seed(seed);
+				TGraph tg(tg_offset[tg_label]);
+				tg.print_to_vcg(vcg_out_);
+			}
 
 		} else if (command == "vcg_hide_edge_labels") {
 			vcg_out_ << "display_edge_labels: no\n";
 
 		} else if (command == "tg_write") {
+			long first = 0;
+			long last = tg_cnt;
+			if (shard_cnt_ > 1) {
+				check_shard(line);
+				first = min<long>(tg_cnt,
+					max(0L, shard_begin(shard_) - graph_number_));
+				last = min<long>(tg_cnt,
+					max(0L, shard_begin(shard_ + 1) - graph_number_));
+			}
+
 			RGen::gen().set_seed(seed);
-			TGraph tg(tg_offset[tg_label]);
+			TGraph tg(tg_offset[tg_label], first, last);
 			tg_offset[tg_label] += tg_cnt;
-			tg.print_to(data_out_);
+
+			if (tg_cnt || writes_here())
+				tg.print_to(data_out());
+
+			graph_number_ += tg_cnt;
 			h_period.push_back(tg.h_period());
 
-		} else if (command == "pe_write") {
+		} else if (command == "tgb_write") {
+// Only the first shard writes the binary file.  The others need the
+// hyperperiod.
+			if (shard_cnt_ > 1)
+				check_shard(line);
+
+			if (! shard_ && ! tgb_out_.is_open()) {
+				tgb_out_.open(tgb_file_name);
+			}
+
 			RGen::gen().set_seed(seed);
-			DBase db(table_offset[table_label], task_type_cnt);
+			TGraph tg(tg_offset[tg_label], 0, shard_ ? 0 : tg_cnt);
+			tg_offset[tg_label] += tg_cnt;
+			if (! shard_)
+				tg.print_to_tgb(tgb_out_);
+
+			h_period.push_back(tg.h_period());
+
+		} else if (command == "pe_write") {
+			if (writes_here()) {
+				RGen::gen().set_seed(seed);
+				DBase db(table_offset[table_label], task_type_cnt);
+				db.print_to(data_out(), table_label);
+			} else {
+// Tables printed after these rely on the alignment they leave.
+				data_out().setf(ios::left);
+			}
+
 			table_offset[table_label] += table_cnt;
-			db.print_to(data_out_, table_label);
 
 		} else if (command == "trans_write") {
-			RGen::gen().set_seed(seed);
+			if (writes_here()) {
+				RGen::gen().set_seed(seed);
 
 // ugly hack
-			double old_av = entries_per_type_av;
-			entries_per_type_av = 1.0;
+				double old_av = entries_per_type_av;
+				entries_per_type_av = 1.0;
+
+				double old_mul = entries_per_type_mul;
+				entries_per_type_mul = 0.0;
 
-			double old_mul = entries_per_type_mul;
-			entries_per_type_mul = 0.0;
+				DBase db(table_offset[table_label], trans_type_cnt);
+				db.trans_print_to(data_out(), table_label);
+
+				entries_per_type_av = old_av;
+				entries_per_type_mul = old_mul;
+			}
 
-			DBase db(table_offset[table_label], trans_type_cnt);
 			table_offset[table_label] += table_cnt;
-			db.trans_print_to(data_out_, table_label);
 
-			entries_per_type_av = old_av;
-			entries_per_type_mul = old_mul;
 		} else if (command == "misc_write") {
-			RGen::gen().set_seed(seed);
-			DBase db(table_offset[table_label], misc_type_cnt);
+			if (writes_here()) {
+				RGen::gen().set_seed(seed);
+				DBase db(table_offset[table_label], misc_type_cnt);
+				db.print_to(data_out(), table_label);
+			} else {
+// Tables printed after these rely on the alignment they leave.
+				data_out().setf(ios::left);
+			}
+
 			table_offset[table_label] += table_cnt;
-			db.print_to(data_out_, table_label);
 
 		} else if (command == "opt_write") {
-//			ifstream is(opt_file_name.begin());
-			ifstream is;
-			is.open(opt_file_name.c_str());
+			if (! writes_here())
+				continue;
 
-			if (! is) parse_error(line);
+			istringstream is(*opt_text_);
 	
 			stringbuf tmp;
 			do {
@@ -641,7 +1290,7 @@ ArgPack::parse() {
 					parse_error(line);
 				}
 
-				data_out_ << "# " << tmp.str();
+				data_out() << "# " << tmp.str();
 			} while (is);
 
 		} else {
@@ -663,6 +1312,24 @@ const char * ArgPack::help_ =
 "    writes PostScript to the [filename].eps file\n"
 "    writes VCG readable graph to the [filename].vcg file\n"
 "    writes data to the [filename].tgff file\n"
+"    writes binary task graphs to the [filename].tgffb file, if asked to\n"
+"    writes statistics to the [filename].json file, if asked to\n"
+"\n"
+"tgff -batch [jobfile] [threads]\n"
+"    runs each job in [jobfile] as above, on up to [threads] threads\n"
+"    (default 1).  A job is one line: <opt file> <seed> <prefix>.\n"
+"    Files are named after <prefix> and commands come from <opt file>.\n"
+"    A <seed> other than - overrides the seed commands in <opt file>.\n"
+"    Each <opt file> is read once, but every job parses its commands and\n"
+"    builds its output anew; batching saves process start-up only.\n"
+"\n"
+"tgff -shard [i/N] [filename]\n"
+"    runs as above, but writes only slice i of N of the .tgff file, to\n"
+"    [filename].[i].tgff if N > 1, for N processes to share a run.  The\n"
+"    slices 0, 1, ... N-1 concatenated are the whole file.  Only slice 0\n"
+"    writes the .eps, .vcg and .tgffb files.  Needs thread_cnt, and\n"
+"    period_grain if any graph is periodic, and neither task_unique nor\n"
+"    period_g_deadline.\n"
 "\n"
 "A \\ can be used to enter multi-line commands.\n"
 "A # at the start of a line comments out the line.\n"
@@ -686,7 +1353,8 @@ const char * ArgPack::help_ =
 "  task_trans_time <flt>: average time per task including communication\n"
 "    (used in setting deadlines)\n"
 "  deadline_jitter <flt>: proportional jitter for deadline\n"
-"  task_cnt <int> <int>: number of tasks per graph (average, multiplier)\n"
+"  task_cnt <int> [<int>]: number of tasks per graph (average, multiplier)\n"
+"    the multiplier keeps its last value if omitted (5 by default)\n"
 "  task_degree <int> <int>: maximum number of transmits (in, out) per task\n"
 "  task_unique <bool>: tasks types are forced to be unique (true by default) \n"
 "  task_type_cnt <int>: number of task types \n"
@@ -695,6 +1363,8 @@ const char * ArgPack::help_ =
 "    name, average, multiplier, round to (default 0.0, 0.0 means no rounding)\n"
 "  period_laxity <flt>: laxity of periods, relative to deadlines (default 1)\n"
 "  period_g_deadline <bool>: periods forced > deadlines (default true)\n"
+"  period_grain <flt>: unit of which periods are period_mul multiples\n"
+"    (default 0: derived from the average graph height and period_laxity)\n"
 "  prob_hard_deadline <flt>: probability that a deadline will be hard (vs. soft)\n"
 "  soft_deadline_mul <flt>: multiplier applied to soft deadlines (default 1)\n"
 "  period_mul <list(<int>)>: multipliers for periods in multirate systems\n"
@@ -704,6 +1374,19 @@ const char * ArgPack::help_ =
 "    start nodes (default 0.0)\n"
 "  start_node <int> <int>: number of start nodes for graphs which have\n"
 "    multiple start nodes (average, multiplier)\n"
+"  gen_compat <bool>: reproduce the graphs of earlier TGFF releases exactly\n"
+"    (default true).  false selects faster indexed graph construction.\n"
+"  thread_cnt <int>: threads used to generate task graphs (default 0)\n"
+"    0 draws every graph from one random stream, as earlier releases did.\n"
+"    Any other count gives each graph its own stream, so output does not\n"
+"    depend on the count.\n"
+"  rng_engine <marsaglia|xoshiro256ss|philox>: random number generator\n"
+"    (default marsaglia).  marsaglia reproduces earlier releases but has\n"
+"    24-bit resolution.  The others give 53-bit values.\n"
+"  stream_write <bool>: write data to the .tgff file as it is produced and\n"
+"    keep task graphs in a temporary file beside it, rather than in memory,\n"
+"    until they are written (default false).  Table rows are written as\n"
+"    they are drawn and never stored.  The output is the same as without it.\n"
 "\n"
 "TGFF series-parallel graph constuction variables:\n"
 "---------------------------------------------------------\n"
@@ -741,11 +1424,22 @@ const char * ArgPack::help_ =
 "  vcg_hide_edge_labels: suppresses display of edge labels  [for .vcg file]\n"
 "  eps_write: make a PostScript plot of the task graphs   [to .eps  file]\n"
 "  tg_write: write the task graphs                        [to .tgff file]\n"
+"  tgb_write: write the task graphs in binary form        [to .tgffb file]\n"
+"    (little-endian, 8-byte aligned; layout in TGBWriter.h and TG.h)\n"
 "  pe_write: write PE information                         [to .tgff file]\n"
 "  trans_write: write transmission event information      [to .tgff file]\n"
 "  misc_write: write independant processor information    [to .tgff file]\n"
 "  misc_type_cnt: number of types for misc_write\n"
 "  note_write <list(<string>)>: write the string(s)       [to .tgff file]\n"
+"  stats_write: write time, CPU time and peak RSS for each command, and\n"
+"    counts of hot path events, as JSON                  [to .json file]\n"
+"    (process-wide figures, so in batch mode they include other jobs)\n"
+"  sweep <command> <values>: run once for every value of <command>, writing\n"
+"    [filename]-<i> files.  <values> is <int>..<int> or a comma separated\n"
+"    list, each entry being the full arguments of <command>, e.g.\n"
+"    sweep seed 1..1000, sweep task_cnt 10,50,200 or\n"
+"    sweep task_cnt 10 1, 50 5.  Several sweeps run every combination, the\n"
+"    first sweep varying fastest.\n"
 "\n"
 "  pack_schedule <int> <int> <flt> <flt> <flt> <flt> ...  [to .tgff file]\n"
 "            ... <int> <int>  <int> <int> [<flt>]         [&  .eps file]\n"
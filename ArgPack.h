@@ -5,22 +5,83 @@
 #define ARG_PACK_H_
 
 /*###########################################################################*/
+#include "RGen.h"
 #include "RVector.h"
 #include "RStd.h"
+#include "TGBWriter.h"
 
 #include <string>
 #include <sstream>
 #include <fstream>
 
+/*===========================================================================*/
+/* One run of tgff.  Commands come from opt_text, the contents of opt_file, and
+output files are named after base; with no base, the commands only set
+options.  If has_seed, seed overrides every seed command. */
+
+class ArgJob {
+public:
+	ArgJob() : base(), opt_file(), opt_text(0), seed(0), has_seed(false),
+		sweep(0), shard(0), shard_cnt(1) {}
+
+		std::string base;
+		std::string opt_file;
+		const std::string * opt_text;
+		int seed;
+		bool has_seed;
+
+// Which combination of sweep values to use, first sweep varying fastest.
+		long sweep;
+
+/* Writes only shard of shard_cnt consecutive slices of the .tgff file, to
+<base>.<shard>.tgff.  The slices in order make up the whole file. */
+		int shard;
+		int shard_cnt;
+};
+
+/*===========================================================================*/
+/* Process-wide resource use and RCounter counts, for stats_write.  Taken
+around each command, so in batch mode they include the other jobs' work. */
+
+class ArgStat {
+public:
+	ArgStat() : command(), line(0), wall(0.0), cpu(0.0), max_rss(0),
+		counter() {}
+
+// Use so far, with wall time since the epoch.
+	static ArgStat now();
+
+// The use between start and this.  The peak RSS is kept as is.
+	ArgStat since(const ArgStat & start) const;
+
+// As a JSON object.
+	void print_to(std::ostream & os) const;
+
+		std::string command;
+		int line;
+		double wall;
+		double cpu;
+		long max_rss;
+		rstd::RVector<long> counter;
+};
+
 /*===========================================================================*/
 class ArgPack {
 public:
 // Holds all arguments to tgff. 
 
+// Each thread sees the ArgPack of the job it is running.
 	static const ArgPack & ap() { RASSERT(def_ap_); return *def_ap_; }
 	static ArgPack & write_ap() { RASSERT(def_ap_); return *def_ap_; }
 
-	ArgPack(int argc, char * const argv[]);
+// Runs tgff with the command line arguments, either once or in batch mode.
+	static void run(int argc, char * const argv[]);
+
+/* Runs every job listed in job_file on up to threads threads.  Jobs share
+only the text of their options files. */
+	static void batch(const std::string & job_file, int threads);
+
+	explicit ArgPack(const ArgJob & job);
 	~ArgPack();
 
 		std::string tg_label;
@@ -50,7 +111,13 @@ public:
 		int start_node_av;
 		int start_node_mul;
 
+		bool gen_compat;
+		int thread_cnt;
+		rstd::RGen::Engine rng_engine;
+		bool stream_write;
+
 		double p_laxity;
+		double period_grain;
 		bool p_greater_deadline;
 		double prob_hard_deadline;
 		double soft_deadline_mul;
@@ -98,19 +165,76 @@ public:
 		std::string eps_file_name;
 		std::string vcg_file_name;
 		std::string opt_file_name;
+		std::string tgb_file_name;
+		std::string stats_file_name;
 
 private:
 // Returns hyperperiod.
 	double parse();
-	void parse_error(int line);
+	static void parse_error(int line);
+
+// Adds job, or one job per combination of values if it has sweep commands.
+	static void add_jobs(const ArgJob & job, rstd::RVector<ArgJob> & jobs);
+
+// The number of task graphs job's tg_write commands write.
+	static long graph_cnt(const ArgJob & job);
 
-		static ArgPack * def_ap_;
+/* Under sharding, the shard which writes graph g of the run, and the data
+after the previous graph.  Graph graph_total_ stands for the end. */
+	int shard_of(long g) const;
+	long shard_begin(int shard) const;
+	bool writes_here() const { return shard_of(graph_number_) == shard_; }
+	void check_shard(int line) const;
+
+	void write_stats() const;
+
+// Where data goes: the buffer, or the data file itself under stream_write.
+	std::ostream & data_out();
+	void open_stream_out();
+
+		static __thread ArgPack * def_ap_;
 		static const char * help_;
 
 		std::ostringstream data_out_;
+		std::ofstream stream_out_;
 		std::ofstream eps_out_;
 		std::ofstream vcg_out_;
-		std::ifstream opt_in_;
+		const std::string * opt_text_;
+		std::istringstream opt_in_;
+		TGBWriter tgb_out_;
+		bool fixed_seed_;
+		long sweep_rem_;
+
+// Without output files, write commands only count graphs.
+		bool write_;
+		int shard_;
+		int shard_cnt_;
+		long graph_total_;
+		long graph_number_;
+
+		bool stats_write_;
+		ArgStat start_;
+		rstd::RVector<ArgStat> stats_;
+
+	friend class ArgPackBind;
+};
+
+/*===========================================================================*/
+// Makes ArgPack::ap() return ap in the calling thread while in scope.
+
+class ArgPackBind {
+public:
+	explicit ArgPackBind(ArgPack & ap) : prev_(ArgPack::def_ap_) {
+		ArgPack::def_ap_ = &ap;
+	}
+
+	~ArgPackBind() { ArgPack::def_ap_ = prev_; }
+
+private:
+	ArgPackBind(const ArgPackBind &);
+	ArgPackBind & operator=(const ArgPackBind &);
+
+		ArgPack * prev_;
 };
 
 /*###########################################################################*/
@@ -6,7 +6,10 @@
 #include "RGen.h"
 #include "Epsilon.h"
 #include "RMath.h"
+#include "RThread.h"
+#include "RWriter.h"
 
+#include <climits>
 #include <cmath>
 #include <cstring>
 #include <iostream>
@@ -16,27 +19,142 @@
 using namespace std;
 using namespace rstd;
 
+/*###########################################################################*/
+// Fills tables on worker threads, counting rows then filling them.
+
+class DBase::Filler {
+public:
+	Filler(DBase & db, RVector<RGen> & gen, bool count) :
+		db_(db), ap_(ArgPack::write_ap()), gen_(gen), count_(count) {}
+
+	void operator()(long x) {
+		ArgPackBind bind(ap_);
+		RGen & gen = gen_[x];
+		const long types = db_.type_cnt_;
+
+		if (count_) {
+			RVector<double> r(types);
+			gen.flat_range_d_fill(r, -1.0, 1.0);
+
+// Counts go one place up, to become the row numbers when summed.
+			MAP(y, types) {
+				db_.row_begin_[x * types + y + 1] = max(0L, imp_cnt(r[y]));
+			}
+
+			return;
+		}
+
+		const long attribs = db_.entry_.size();
+		const long begin = db_.row(x, 0);
+		RVector<double> jits((db_.row(x + 1, 0) - begin) * attribs);
+		gen.flat_range_d_fill(jits, -1.0, 1.0);
+
+		MAP(y, types) {
+			for (long r = db_.row(x, y); r < db_.row(x, y + 1); r++) {
+				MAP(z, attribs) {
+					db_.entry_[z][r] =
+						db_.entry(x, y, z, jits[(r - begin) * attribs + z]);
+				}
+			}
+		}
+	}
+
+private:
+		DBase & db_;
+		ArgPack & ap_;
+		RVector<RGen> & gen_;
+		bool count_;
+};
+
+/*###########################################################################*/
+// Produces the rows of each type in turn, from the columns or drawn anew.
+
+class DBase::Rows {
+public:
+	Rows(const DBase & db, bool draw) :
+		db_(db), draw_(draw), table_(-1) {}
+
+/* Puts the implementations of type y in table x in vals, one row of
+attributes after another, and returns how many there are.  Types must be
+visited in table order. */
+	long get(long x, long y, RVector<double> & vals);
+
+private:
+		const DBase & db_;
+		bool draw_;
+
+// Stream and implementation counts of the current table, under thread_cnt.
+		RGen gen_;
+		RVector<long> cnt_;
+		long table_;
+};
+
+/*===========================================================================*/
+long DBase::Rows::get(long x, long y, RVector<double> & vals) {
+	const long attribs = db_.entry_.size();
+
+	if (! draw_) {
+		const long imps = db_.row(x, y + 1) - db_.row(x, y);
+		vals.resize(imps * attribs);
+
+		MAP2(imp, imps, z, attribs) {
+			vals[imp * attribs + z] = db_.entry_[z][db_.row(x, y) + imp];
+		}
+
+		return imps;
+	}
+
+	long imps;
+	RGen * gen = &RGen::gen();
+	if (ArgPack::ap().thread_cnt) {
+// Draws as fill_parallel does, with a table's counts coming before its rows.
+		if (x != table_) {
+			gen_.set_engine(ArgPack::ap().rng_engine);
+			gen_.set_seed(db_.seed_, x);
+			table_ = x;
+
+			RVector<double> r(db_.type_cnt_);
+			gen_.flat_range_d_fill(r, -1.0, 1.0);
+
+			cnt_.resize(db_.type_cnt_);
+			MAP(t, db_.type_cnt_) {
+				cnt_[t] = max(0L, imp_cnt(r[t]));
+			}
+		}
+
+		imps = cnt_[y];
+		gen = &gen_;
+	} else {
+		imps = max(0L, imp_cnt(RGen::gen().flat_range_d(-1.0, 1.0)));
+	}
+
+	vals.resize(imps * attribs);
+	gen->flat_range_d_fill(vals, -1.0, 1.0);
+
+	MAP2(imp, imps, z, attribs) {
+		vals[imp * attribs + z] = db_.entry(x, y, z, vals[imp * attribs + z]);
+	}
+
+	return imps;
+}
+
 /*###########################################################################*/
 DBase::DBase(int table_offset, int type_cnt) :
 	type_cnt_(type_cnt),
 	table_offset_(table_offset),
 	table_(ArgPack::ap().table_cnt, ArgPack::ap().table_av.size()),
-
-	table_type_(ArgPack::ap().table_cnt, type_cnt_, ArgPack::ap().type_av.size()),
-
+	table_stream_(ArgPack::ap().table_cnt),
+	type_stream_(type_cnt_),
+	seed_(0),
+	streamed_(ArgPack::ap().stream_write),
+	row_begin_(1, 0L),
+	entry_(ArgPack::ap().type_av.size()),
 	table_name_(ArgPack::ap().table_name),
 	type_name_(ArgPack::ap().type_name),
 	f_width_(0)
 {
-	RVector<double> table_stream(ArgPack::ap().table_cnt);
-	MAP(x, table_stream.size()) {
-		table_stream[x] = RGen::gen().flat_range_d(-1.0, 1.0);
-	}
-
-	RVector<double> type_stream(type_cnt_);
-	MAP(x, type_stream.size()) {
-		type_stream[x] = RGen::gen().flat_range_d(-1.0, 1.0);
-	}
+	RGen::gen().flat_range_d_fill(table_stream_, -1.0, 1.0);
+	RGen::gen().flat_range_d_fill(type_stream_, -1.0, 1.0);
 
 /*-------------------------------------*/
 	MAP(x, table_name_.size()) {
@@ -47,11 +165,14 @@ DBase::DBase(int table_offset, int type_cnt) :
 		f_width_ = max(f_width_, type_name_[x].size() + 2);
 	}
 
+	RVector<double> jits(table_.size()[0] * table_.size()[1]);
+	RGen::gen().flat_range_d_fill(jits, -1.0, 1.0);
+
 	MAP2(x, table_.size()[0], y, table_.size()[1]) {
-		double jit = RGen::gen().flat_range_d(-1.0, 1.0);
+		double jit = jits[x * table_.size()[1] + y];
 
 		double deviation =
-			flat_merge(ArgPack::ap().table_jitter[y], jit, table_stream[x]);
+			flat_merge(ArgPack::ap().table_jitter[y], jit, table_stream_[x]);
 
 		deviation *= ArgPack::ap().table_mul[y];
 
@@ -63,109 +184,167 @@ DBase::DBase(int table_offset, int type_cnt) :
 		}
 	}
 
-// x: table, y: type, z: attribute
-	MAP2(x, table_type_.size()[0], y, table_type_.size()[1]) {
-		long imp_cnt = static_cast<long>(rint(
-			ArgPack::ap().entries_per_type_av +
-			ArgPack::ap().entries_per_type_mul *
-			RGen::gen().flat_range_d(-1.0, 1.0)));
+// One stream per table, seeded from the shared stream.
+	if (ArgPack::ap().thread_cnt) {
+		seed_ = RGen::gen().flat_range_l(0, INT_MAX);
+	}
+
+	if (streamed_) {
+		return;
+	}
+
+	if (ArgPack::ap().thread_cnt) {
+		fill_parallel();
+	} else {
+		fill_serial();
+	}
+}
+
+/*===========================================================================*/
+long DBase::imp_cnt(double r) {
+	return static_cast<long>(rint(ArgPack::ap().entries_per_type_av +
+		ArgPack::ap().entries_per_type_mul * r));
+}
 
-		MAP2(imp, imp_cnt, z, table_type_.size()[2]) {
-			double deviation = flat_merge(ArgPack::ap().type_table_ratio,
-				type_stream[y], table_stream[x]);
+/*===========================================================================*/
+double DBase::entry(long x, long y, long z, double jit) const {
+	double deviation = flat_merge(ArgPack::ap().type_table_ratio,
+		type_stream_[y], table_stream_[x]);
 
-			double jit = RGen::gen().flat_range_d(-1.0, 1.0);
+	deviation = flat_merge(ArgPack::ap().type_jitter[z], jit, deviation);
+	deviation *= ArgPack::ap().type_mul[z];
 
-			deviation = flat_merge(ArgPack::ap().type_jitter[z], jit, deviation);
+	double val = ArgPack::ap().type_av[z] + deviation;
+	if (eps_not_equal_to<double>()(ArgPack::ap().type_round[z], 0.0)) {
+		val = interval_round(val, ArgPack::ap().type_round[z]);
+	}
 
-			deviation *= ArgPack::ap().type_mul[z];
+	return val;
+}
 
-	 		table_type_(x, y, z).push_back(ArgPack::ap().type_av[z] + deviation);
+/*===========================================================================*/
+void DBase::fill_serial() {
+	const long attribs = entry_.size();
+	row_begin_.reserve(table_.size()[0] * type_cnt_ + 1);
 
-			if (eps_not_equal_to<double>()(ArgPack::ap().type_round[z], 0.0)) {
-				table_type_(x, y, z).back() =
-				  interval_round(table_type_(x, y, z).back(),
-				  ArgPack::ap().type_round[z]);
-			}
+// x: table, y: type, z: attribute
+	Rows rows(*this, true);
+	RVector<double> vals;
+	MAP2(x, table_.size()[0], y, type_cnt_) {
+		const long imps = rows.get(x, y, vals);
+
+		MAP2(imp, imps, z, attribs) {
+			entry_[z].push_back(vals[imp * attribs + z]);
 		}
+
+		row_begin_.push_back(row_begin_.back() + imps);
 	}
 }
 
+/*===========================================================================*/
+void DBase::fill_parallel() {
+	const long tables = table_.size()[0];
+
+	RVector<RGen> gen(tables);
+	MAP(x, tables) {
+		gen[x].set_engine(ArgPack::ap().rng_engine);
+		gen[x].set_seed(seed_, x);
+	}
+
+	row_begin_.resize(tables * type_cnt_ + 1);
+	parallel_map(tables, ArgPack::ap().thread_cnt, Filler(*this, gen, true));
+
+	MAP(r, tables * type_cnt_) {
+		row_begin_[r + 1] += row_begin_[r];
+	}
+
+	MAP(z, entry_.size()) {
+		entry_[z].resize(row_begin_.back());
+	}
+
+	parallel_map(tables, ArgPack::ap().thread_cnt, Filler(*this, gen, false));
+}
+
 /*===========================================================================*/
 void DBase::print_to(ostream & os, const string & table_label) const {
 // Print out the tables.
 
-// FIXME: Library bug breaks string setw().  Use c_str() hack.
-
 	os.setf(ios::left);
+	RWriter out(os);
+	Rows rows(*this, streamed_);
+	RVector<double> vals;
 
 	MAP(x, table_.size()[0]) {
-		os << "@" << table_label << " " <<
+		out << "@" << table_label << " " <<
 		  (x + table_offset_) << " {\n";
 
 		if (table_name_.size()) {
-			os << "# ";
+			out << "# ";
 
 			MAP(y, table_name_.size()) {
 				if (y != table_name_.size() - 1) {
-					os << setw(f_width_);
+					out.setw(f_width_);
 				}
 
-				os << table_name_[y].c_str();
+				out << table_name_[y];
 			}
 
-			os << "\n  ";
+			out << "\n  ";
 
 			MAP(y, table_.size()[1]) {
 				if (y != table_.size()[1] - 1) {
-					os << setw(f_width_);
+					out.setw(f_width_);
 				}
 
-				os << table_(x, y);
+				out << table_(x, y);
 			}
 
-			os << "\n";
+			out << "\n";
 		}
 
 		if (type_cnt_ && table_name_.size()) {
-			os << "\n#----------------------------------------" <<
+			out << "\n#----------------------------------------" <<
 			  "--------------------------------------\n";
 		}
 
 		if (type_cnt_) {
-			os << "# " << "type version ";
+			out << "# " << "type version ";
 			MAP(y, type_name_.size()) {
 				if (y != type_name_.size() - 1)
-					os << setw(f_width_);
+					out.setw(f_width_);
 
-				os << type_name_[y].c_str();
+				out << type_name_[y];
 			}
 
-			os << "\n";
+			out << "\n";
 
 // All types, all implementations
-			MAP2(y, table_type_.size()[1],
-				implemen, table_type_(x, y, 0).size())
-			{
-				os << setw(2) << "  " << setw(strlen("type ")) << y <<
-				  setw(strlen("version ")) << implemen;
+			MAP(y, type_cnt_) {
+				const long imps = rows.get(x, y, vals);
+
+				MAP(implemen, imps) {
+					out.setw(2) << "  ";
+					out.setw(strlen("type ")) << y;
+					out.setw(strlen("version ")) << implemen;
 
 // implementations, and attributes.
-				MAP(z, table_type_.size()[2]) {
-					if (z != table_type_.size()[2] - 1) {
-						os << setw(f_width_);
-					}
+					MAP(z, entry_.size()) {
+						if (z != entry_.size() - 1) {
+							out.setw(f_width_);
+						}
 
-					os << table_type_(x, y, z)[implemen];
+						out << vals[implemen * entry_.size() + z];
+					}
+					out << "\n";
 				}
-				os << "\n";
 			}
 		}
 
-		os << "}\n\n\n";
+		out << "}\n\n\n";
 	}
 
-	os << "\n";
+	out << "\n";
+	out.flush();
 
 	os.clear();
 }
@@ -174,55 +353,65 @@ void DBase::print_to(ostream & os, const string & table_label) const {
 /*===========================================================================*/
 void DBase::trans_print_to(ostream & os, const string & table_label) const {
 // Print out the tables.
+	RWriter out(os);
+	Rows rows(*this, streamed_);
+	RVector<double> vals;
+
 	MAP(x, table_.size()[0]) {
-		os << "@" << table_label << " " <<
+		out << "@" << table_label << " " <<
 		  (x + table_offset_) << " {\n";
 
 		if (table_name_.size()) {
-			os << "# ";
+			out << "# ";
 
 			MAP(y, table_name_.size()) {
-				os << " " << setw(f_width_) << table_name_[y].c_str();
+				out << " ";
+				out.setw(f_width_) << table_name_[y];
 			}
 
-			os << "\n  ";
+			out << "\n  ";
 
 			MAP(y, table_.size()[1]) {
-				os << " " << setw(f_width_) << table_(x, y);
+				out << " ";
+				out.setw(f_width_) << table_(x, y);
 			}
 
-			os << "\n";
+			out << "\n";
 		}
 
 		if (type_cnt_ && table_name_.size()) {
-			os << "\n#----------------------------------------" <<
+			out << "\n#----------------------------------------" <<
 			  "--------------------------------------\n";
 		}
 
 		if (type_cnt_) {
-			os << "# " << "type ";
+			out << "# " << "type ";
 			MAP(y, type_name_.size()) {
-				os << " " << setw(f_width_) << type_name_[y].c_str();
+				out << " ";
+				out.setw(f_width_) << type_name_[y];
 			}
 
-			os << "\n";
+			out << "\n";
 
 // All types
-			MAP(y, table_type_.size()[1]) {
-				os << "  " << setw(strlen("type ")) << y;
+			MAP(y, type_cnt_) {
+				const long imps = rows.get(x, y, vals);
+				RASSERT(imps == 1);
+				out << "  ";
+				out.setw(strlen("type ")) << y;
 // attributes.
-				MAP(z, table_type_.size()[2]) {
-					RASSERT(table_type_(x, y, z).size() == 1);
-					os << " " << setw(f_width_) << table_type_(x, y, z).back();
+				MAP(z, entry_.size()) {
+					out << " ";
+					out.setw(f_width_) << vals[z];
 				}
-				os << "\n";
+				out << "\n";
 			}
 		}
 
-		os << "}\n\n\n";
+		out << "}\n\n\n";
 	}
 
-	os << "\n";
+	out << "\n";
 }
 
 
@@ -21,14 +21,47 @@ public:
 	void trans_print_to(std::ostream &os, const std::string & table_label)const;
 
 private:
+	class Filler;
+	friend class Filler;
+	class Rows;
+	friend class Rows;
+
+// Draws the rows of all tables from the shared stream, in order.
+	void fill_serial();
+
+// Draws each table's rows from its own stream, on thread_cnt threads.
+	void fill_parallel();
+
+// Number of implementations of a type, from a draw in [-1, 1).
+	static long imp_cnt(double r);
+
+// Attribute z of an implementation of type y in table x.
+	double entry(long x, long y, long z, double jit) const;
+
+// First row of type y in table x.  Type y's rows end where type y + 1's begin.
+	long row(long x, long y) const { return row_begin_[x * type_cnt_ + y]; }
+
 		int type_cnt_;
 		int table_offset_;
 
 // PE, attribute
 		rstd::RecVector2<double> table_;
 
-// PE, type, attribute, different implementations
-		rstd::RecVector3<rstd::RVector<double> > table_type_;
+		rstd::RVector<double> table_stream_;
+		rstd::RVector<double> type_stream_;
+
+// Seeds the per-table streams under thread_cnt.
+		int seed_;
+
+/* Under stream_write the rows are not stored.  They are drawn as they are
+printed, so the tables can be printed only once. */
+		bool streamed_;
+
+/* One row per implementation, for all types of all tables in order, with a
+column per type attribute. */
+		rstd::RVector<long> row_begin_;
+		rstd::RVector<rstd::RVector<double> > entry_;
+
 		const rstd::RVector<std::string> & table_name_;
 		const rstd::RVector<std::string> & type_name_;
 
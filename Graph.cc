@@ -8,6 +8,7 @@
 #include <typeinfo>
 #include <iostream>
 #include "Epsilon.h"
+#include "RCounter.h"
 
 namespace rstd {
 using namespace std;
@@ -15,35 +16,31 @@ using namespace std;
 const RawGraph::vertex_index RawGraph::INVALID_VINDEX = -1;
 const RawGraph::edge_index RawGraph::INVALID_EINDEX = -1;
 
+namespace {
+	RCounter cyclic_cnt("cyclic");
+	RCounter erase_edge_cnt("erase_edge");
+}
+
 /*###########################################################################*/
 RawGraph &
 RawGraph::operator=(const self & a) {
 	vertex_ = a.vertex_;
 	edge_ = a.edge_;
+	frozen_ = a.frozen_;
+	csr_ = a.csr_;
 	return *this;
 }
 
-/*===========================================================================*/
-comp_type
-RawGraph::vertex_index::comp(const vertex_index & a) const {
-	return rstd::comp(index_, a.index_);
-}
-
 /*===========================================================================*/
 RawGraph::vertex_index RawGraph::add_vertex() {
 	vertex_type new_vertex;
 	vertex_.push_back(new_vertex);
+	frozen_ = false;
 
 	RDEBUG(self_check());
 	return vertex_.size() - 1;
 }
 
-/*===========================================================================*/
-comp_type
-RawGraph::edge_index::comp(const edge_index & a) const {
-	return rstd::comp(index_, a.index_);
-}
-
 /*===========================================================================*/
 RawGraph::edge_index RawGraph::
 add_edge(const vertex_index from, const vertex_index to) {
@@ -52,6 +49,7 @@ add_edge(const vertex_index from, const vertex_index to) {
 	edge_index e = edge_.size() - 1;
 	vertex(to)->in_.push_back(e);
 	vertex(from)->out_.push_back(e);
+	frozen_ = false;
 
 	RDEBUG(self_check());
 	return e;
@@ -84,6 +82,7 @@ void RawGraph::erase_vertex(const vertex_index i) {
 
 // Erase the vertex.
 	vertex_.erase(v);
+	frozen_ = false;
 
 // Fix all of the other vertex indices.
 	MAP(x, edge_.size()) {
@@ -104,18 +103,31 @@ void RawGraph::erase_vertex(const vertex_index i) {
 /*===========================================================================*/
 void RawGraph::erase_edge(const edge_index i) {
 	RASSERT(i < size_edge());
-// Fix connected vertices.
-	vertex_type & parent = *vertex(edge(i)->from());
-	vertex_type & child = *vertex(edge(i)->to());
+	erase_edge_cnt.add();
 
-	RVector<edge_index>::iterator parent_edge =
-		find(parent.out_.begin(), parent.out_.end(), i);
+	unlink_edge(i);
 
-	RVector<edge_index>::iterator child_edge =
-		find(child.in_.begin(), child.in_.end(), i);
+// Move the last edge into the hole and point its endpoints at it.
+	const edge_index last = edge_.size() - 1;
+	if (i != last) {
+		edge_[i] = edge_[last];
 
-	parent.out_.erase(parent_edge);
-	child.in_.erase(child_edge);
+		vertex_type & parent = *vertex(edge_[i].from_);
+		vertex_type & child = *vertex(edge_[i].to_);
+		*find(parent.out_.begin(), parent.out_.end(), last) = i;
+		*find(child.in_.begin(), child.in_.end(), last) = i;
+	}
+
+	edge_.pop_back();
+	RDEBUG(self_check());
+}
+
+/*===========================================================================*/
+void RawGraph::erase_edge_ordered(const edge_index i) {
+	RASSERT(i < size_edge());
+	erase_edge_cnt.add();
+
+	unlink_edge(i);
 
 // Erase the edge.
 	edge_.erase(edge(i));
@@ -141,6 +153,120 @@ void RawGraph::erase_edge(const edge_index i) {
 	RDEBUG(self_check());
 }
 
+/*===========================================================================*/
+const RVector<RawGraph::vertex_index>
+RawGraph::erase_vertices(const RVector<vertex_index> & v) {
+	RVector<vertex_index> v_map;
+	RVector<edge_index> e_map;
+	compact(v, RVector<edge_index>(), v_map, e_map);
+	return v_map;
+}
+
+/*===========================================================================*/
+const RVector<RawGraph::edge_index>
+RawGraph::erase_edges(const RVector<edge_index> & e) {
+	RVector<vertex_index> v_map;
+	RVector<edge_index> e_map;
+	compact(RVector<vertex_index>(), e, v_map, e_map);
+	return e_map;
+}
+
+/*===========================================================================*/
+void RawGraph::compact(const RVector<vertex_index> & v,
+const RVector<edge_index> & e, RVector<vertex_index> & v_map,
+RVector<edge_index> & e_map) {
+	frozen_ = false;
+
+// Mark, then number what is left in order.
+	v_map.assign(vertex_.size(), 0L);
+	MAP(x, v.size()) {
+		v_map[v[x]] = INVALID_VINDEX;
+	}
+
+	long v_kept = 0;
+	MAP(x, v_map.size()) {
+		if (v_map[x] != INVALID_VINDEX) {
+			v_map[x] = v_kept++;
+		}
+	}
+
+	e_map.assign(edge_.size(), 0L);
+	MAP(x, e.size()) {
+		e_map[e[x]] = INVALID_EINDEX;
+	}
+
+	long e_kept = 0;
+	MAP(x, e_map.size()) {
+		if (e_map[x] != INVALID_EINDEX &&
+			v_map[edge_[x].from_] != INVALID_VINDEX &&
+			v_map[edge_[x].to_] != INVALID_VINDEX)
+		{
+			e_map[x] = e_kept++;
+		} else {
+			e_map[x] = INVALID_EINDEX;
+		}
+	}
+
+// Slide everything kept down to its new index.
+	MAP(x, edge_.size()) {
+		if (e_map[x] != INVALID_EINDEX) {
+			edge_type & moved = edge_[e_map[x]];
+			moved = edge_[x];
+			moved.from_ = v_map[moved.from_];
+			moved.to_ = v_map[moved.to_];
+		}
+	}
+	edge_.erase(edge_.begin() + e_kept, edge_.end());
+
+	MAP(x, vertex_.size()) {
+		if (v_map[x] == INVALID_VINDEX)
+			continue;
+
+		RVector<edge_index> & out = vertex_[x].out_;
+		long out_kept = 0;
+		MAP(y, out.size()) {
+			if (e_map[out[y]] != INVALID_EINDEX) {
+				out[out_kept++] = e_map[out[y]];
+			}
+		}
+		out.erase(out.begin() + out_kept, out.end());
+
+		RVector<edge_index> & in = vertex_[x].in_;
+		long in_kept = 0;
+		MAP(y, in.size()) {
+			if (e_map[in[y]] != INVALID_EINDEX) {
+				in[in_kept++] = e_map[in[y]];
+			}
+		}
+		in.erase(in.begin() + in_kept, in.end());
+
+		if (v_map[x] != x) {
+			vertex_[v_map[x]].out_.rswap(out);
+			vertex_[v_map[x]].in_.rswap(in);
+		}
+	}
+	vertex_.resize(v_kept);
+
+	RDEBUG(self_check());
+}
+
+/*===========================================================================*/
+void RawGraph::unlink_edge(const edge_index i) {
+// Fix connected vertices.
+	vertex_type & parent = *vertex(edge(i)->from());
+	vertex_type & child = *vertex(edge(i)->to());
+
+	RVector<edge_index>::iterator parent_edge =
+		find(parent.out_.begin(), parent.out_.end(), i);
+
+	RVector<edge_index>::iterator child_edge =
+		find(child.in_.begin(), child.in_.end(), i);
+
+	parent.out_.erase(parent_edge);
+	child.in_.erase(child_edge);
+	frozen_ = false;
+}
+
 /*===========================================================================*/
 void RawGraph::pack_memory() {
 	RVector<vertex_type> v(vertex_);
@@ -153,6 +279,7 @@ void RawGraph::pack_memory() {
 void RawGraph::clear() {
 	vertex_.clear();
 	edge_.clear();
+	frozen_ = false;
 	RDEBUG(self_check());
 }
 
@@ -160,10 +287,84 @@ void RawGraph::clear() {
 void RawGraph::rswap(RawGraph & rg) {
 	vertex_.rswap(rg.vertex_);
 	edge_.rswap(rg.edge_);
+	swap(frozen_, rg.frozen_);
+	csr_.rswap(rg.csr_);
 	RDEBUG(self_check());
 	RDEBUG(rg.self_check());
 }
 
+/*===========================================================================*/
+void RawGraph::freeze() {
+	freeze_to(csr_);
+	frozen_ = true;
+}
+
+/*===========================================================================*/
+void RawGraph::freeze_to(frozen_type & csr) const {
+	const long v_cnt = vertex_.size();
+	csr.out_begin.resize(v_cnt + 1);
+	csr.in_begin.resize(v_cnt + 1);
+	csr.out_vertex.resize(edge_.size());
+	csr.out_edge.resize(edge_.size());
+	csr.in_vertex.resize(edge_.size());
+	csr.in_edge.resize(edge_.size());
+
+	long out_pos = 0;
+	long in_pos = 0;
+	MAP(x, v_cnt) {
+		csr.out_begin[x] = out_pos;
+		MAP(y, vertex_[x].out_.size()) {
+			const long e = vertex_[x].out_[y];
+			csr.out_edge[out_pos] = e;
+			csr.out_vertex[out_pos++] = edge_[e].to_;
+		}
+
+		csr.in_begin[x] = in_pos;
+		MAP(y, vertex_[x].in_.size()) {
+			const long e = vertex_[x].in_[y];
+			csr.in_edge[in_pos] = e;
+			csr.in_vertex[in_pos++] = edge_[e].from_;
+		}
+	}
+
+	csr.out_begin[v_cnt] = out_pos;
+	csr.in_begin[v_cnt] = in_pos;
+}
+
+/*===========================================================================*/
+void RawGraph::order_edges(const frozen_type & csr) {
+	RASSERT(csr.out_begin.size() == vertex_.size() + 1);
+	RASSERT(csr.in_begin.size() == vertex_.size() + 1);
+
+	MAP(x, vertex_.size()) {
+		vertex_type & v = vertex_[x];
+		RASSERT(csr.out_begin[x + 1] - csr.out_begin[x] == v.out_.size());
+		RASSERT(csr.in_begin[x + 1] - csr.in_begin[x] == v.in_.size());
+
+		MAP(y, v.out_.size()) {
+			v.out_[y] = csr.out_edge[csr.out_begin[x] + y];
+			RASSERT(edge_[v.out_[y]].from_ == x);
+		}
+
+		MAP(y, v.in_.size()) {
+			v.in_[y] = csr.in_edge[csr.in_begin[x] + y];
+			RASSERT(edge_[v.in_[y]].to_ == x);
+		}
+	}
+
+	frozen_ = false;
+}
+
+/*===========================================================================*/
+void RawGraph::frozen_type::rswap(frozen_type & a) {
+	out_begin.rswap(a.out_begin);
+	out_vertex.rswap(a.out_vertex);
+	out_edge.rswap(a.out_edge);
+	in_begin.rswap(a.in_begin);
+	in_vertex.rswap(a.in_vertex);
+	in_edge.rswap(a.in_edge);
+}
+
 /*===========================================================================*/
 void RawGraph::print_to(ostream & os) const {
 	MAP(x, vertex_.size()) {
@@ -181,9 +382,36 @@ void RawGraph::print_to(ostream & os) const {
 
 /*===========================================================================*/
 bool RawGraph::cyclic() const {
+	traversal_scratch scratch;
+	return cyclic(scratch);
+}
+
+/*===========================================================================*/
+bool RawGraph::cyclic(traversal_scratch & s) const {
+	cyclic_cnt.add();
+	s.begin(vertex_.size());
+
+	MAP(start, vertex_.size()) {
+		if (! s.seen(start) && cyclic_visit(0, s, start))
+			return true;
+	}
+	return false;
+}
+
+/*===========================================================================*/
+bool RawGraph::find_cycle(RVector<vertex_index> & cycle) const {
+	traversal_scratch scratch;
+	return find_cycle(cycle, scratch);
+}
+
+/*===========================================================================*/
+bool RawGraph::find_cycle(RVector<vertex_index> & cycle,
+traversal_scratch & s) const {
+	cycle.clear();
+	s.begin(vertex_.size());
+
 	MAP(start, vertex_.size()) {
-		RVector<big_bool> visited(vertex_.size(), false);
-		if (cyclic_recurse(visited, start, start))
+		if (! s.seen(start) && cyclic_visit(&cycle, s, start))
 			return true;
 	}
 	return false;
@@ -216,8 +444,9 @@ nodes_linked (vertex_index a, vertex_index b) const {
 const RVector<RawGraph::vertex_index> RawGraph::
 dfs(const vertex_index start, bool reverse_i) const {
 	RVector<vertex_index> vec;
-	RVector<big_bool> visited(vertex_.size(), false);
-	dfs_recurse(vec, visited, start, reverse_i);
+	traversal_scratch s;
+	s.begin(vertex_.size());
+	dfs_visit(&vec, s, start, reverse_i);
 	return vec;
 }
 
@@ -225,22 +454,31 @@ dfs(const vertex_index start, bool reverse_i) const {
 const RVector<RawGraph::vertex_index>
 RawGraph::dfs(RVector<vertex_index> start, bool reverse_i) const {
 	RVector<vertex_index> vec;
-	RVector<big_bool> visited(vertex_.size(), false);
+	traversal_scratch s;
+	dfs(vec, start, reverse_i, s);
+	return vec;
+}
+
+/*===========================================================================*/
+void RawGraph::dfs(RVector<vertex_index> & vec,
+const RVector<vertex_index> & start, bool reverse_i,
+traversal_scratch & s) const {
+	vec.clear();
+	s.begin(vertex_.size());
 
 	MAP(x, start.size()) {
-		dfs_recurse(vec, visited, start[x], reverse_i);
+		dfs_visit(&vec, s, start[x], reverse_i);
 	}
-
-	return vec;
 }
 
 /*===========================================================================*/
 const RVector<RawGraph::vertex_index>
 RawGraph::bfs(const vertex_index start, bool reverse_i) const {
 	RVector<vertex_index> vec;
-	RVector<big_bool> visited(vertex_.size(), false);
-	visited[start] = true;
-	bfs_recurse(vec, visited, start, reverse_i);
+	traversal_scratch s;
+	s.begin(vertex_.size());
+	s.see(start);
+	bfs_visit(vec, s, start, reverse_i, false);
 	return vec;
 }
 
@@ -248,14 +486,22 @@ RawGraph::bfs(const vertex_index start, bool reverse_i) const {
 const RVector<RawGraph::vertex_index>
 RawGraph::bfs(RVector<vertex_index> start, bool reverse_i) const {
 	RVector<vertex_index> vec;
-	RVector<big_bool> visited(vertex_.size(), false);
+	traversal_scratch s;
+	bfs(vec, start, reverse_i, s);
+	return vec;
+}
+
+/*===========================================================================*/
+void RawGraph::bfs(RVector<vertex_index> & vec,
+const RVector<vertex_index> & start, bool reverse_i,
+traversal_scratch & s) const {
+	vec.clear();
+	s.begin(vertex_.size());
 
 	MAP(x, start.size()) {
-		visited[start[x]] = true;
-		bfs_recurse(vec, visited, start[x], reverse_i);
+		s.see(start[x]);
+		bfs_visit(vec, s, start[x], reverse_i, false);
 	}
-
-	return vec;
 }
 
 /*===========================================================================*/
@@ -316,22 +562,8 @@ Rabort();
 const RVector<RawGraph::vertex_index> RawGraph::
 top_sort(const vertex_index start, bool reverse_i) const {
 	RVector<vertex_index> vec;
-	RVector<big_bool> visited(vertex_.size(), false);
-
-// For now, allow only source or sink start nodes.
-	RASSERT(reverse_i && ! vertex_[start].size_out() ||
-		! reverse_i && ! vertex_[start].size_in());
-
-// Figure out which nodes can be reached.
-	dfs_recurse(vec, visited, start, reverse_i);
-
-// Invert to pre-visit nodes which can't be reached.
-	transform(visited.begin(), visited.end(), visited.begin(),
-	  logical_not<big_bool>());
-
-	vec.erase(vec.begin(), vec.end());
-
-	top_sort_recurse(vec, visited, start, reverse_i);
+	traversal_scratch s;
+	top_sort(vec, RVector<vertex_index>(1, start), reverse_i, s);
 	return vec;
 }
 
@@ -339,7 +571,17 @@ top_sort(const vertex_index start, bool reverse_i) const {
 const RVector<RawGraph::vertex_index> RawGraph::
 top_sort(const RVector<vertex_index> & start, bool reverse_i) const {
 	RVector<vertex_index> vec;
-	RVector<big_bool> visited(vertex_.size(), false);
+	traversal_scratch s;
+	top_sort(vec, start, reverse_i, s);
+	return vec;
+}
+
+/*===========================================================================*/
+void RawGraph::top_sort(RVector<vertex_index> & vec,
+const RVector<vertex_index> & start, bool reverse_i,
+traversal_scratch & s) const {
+	vec.clear();
+	s.begin(vertex_.size());
 
 // Figure out which nodes can be reached.
 	MAP(x, start.size()) {
@@ -347,47 +589,41 @@ top_sort(const RVector<vertex_index> & start, bool reverse_i) const {
 		RASSERT(reverse_i && ! vertex_[start[x]].size_out() ||
 			! reverse_i && ! vertex_[start[x]].size_in());
 
-		dfs_recurse(vec, visited, start[x], reverse_i);
+		dfs_visit(0, s, start[x], reverse_i);
 	}
 
 // Invert to pre-visit nodes which can't be reached.
-	transform(visited.begin(), visited.end(), visited.begin(),
-	  logical_not<big_bool>());
-	vec.erase(vec.begin(), vec.end());
+	s.invert();
 
-	MAP(x, start.size())
-		top_sort_recurse(vec, visited, start[x], reverse_i);
-
-	return vec;
+	MAP(x, start.size()) {
+		top_sort_visit(&vec, 0, s, start[x], reverse_i);
+	}
 }
 
 /*===========================================================================*/
 const RVector<RawGraph::vertex_index> RawGraph::
 RawGraph::outward_crawl(const vertex_index start) const {
 	RVector<vertex_index> vec;
-	RVector<big_bool> visited(vertex_.size(), false);
-	visited[start] = true;
-	outward_crawl_recurse(vec, visited, start);
+	traversal_scratch s;
+	outward_crawl(vec, start, s);
 	return vec;
 }
 
+/*===========================================================================*/
+void RawGraph::outward_crawl(RVector<vertex_index> & vec,
+const vertex_index start, traversal_scratch & s) const {
+	vec.clear();
+	s.begin(vertex_.size());
+	s.see(start);
+	bfs_visit(vec, s, start, false, true);
+}
+
 /*===========================================================================*/
 const RVector<int>
 RawGraph::max_depth(const vertex_index start, bool reverse_i) const {
-	RVector<int> vec(vertex_.size(), -1);
-	RVector<big_bool> visited(vertex_.size(), false);
-
-// Figure out which nodes can be reached.
-	RVector<vertex_index> scratch;
-	dfs_recurse(scratch, visited, start, reverse_i);
-	scratch.erase(scratch.begin(), scratch.end());
-
-// Invert to pre-visit nodes which can't be reached.
-	transform(visited.begin(), visited.end(), visited.begin(),
-	  logical_not<big_bool>());
-
-	vec[start] = 0;
-	max_depth_recurse(vec, visited, start, reverse_i);
+	RVector<int> vec;
+	traversal_scratch s;
+	max_depth(vec, RVector<vertex_index>(1, start), reverse_i, s);
 	return vec;
 }
 
@@ -395,25 +631,77 @@ RawGraph::max_depth(const vertex_index start, bool reverse_i) const {
 const RVector<int>
 RawGraph::max_depth(const RVector<vertex_index> & start,
 bool reverse_i) const {
-	RVector<int> vec(vertex_.size(), -1);
-	RVector<big_bool> visited(vertex_.size(), false);
-
-	RVector<vertex_index> scratch;
+	RVector<int> vec;
+	traversal_scratch s;
+	max_depth(vec, start, reverse_i, s);
+	return vec;
+}
 
-	MAP(x, start.size())
-		dfs_recurse(scratch, visited, start[x], reverse_i);
+/*===========================================================================*/
+void RawGraph::max_depth(RVector<int> & vec,
+const RVector<vertex_index> & start, bool reverse_i,
+traversal_scratch & s) const {
+	vec.assign(vertex_.size(), -1);
+	s.begin(vertex_.size());
 
-	scratch.erase(scratch.begin(), scratch.end());
+// Figure out which nodes can be reached.
+	MAP(x, start.size()) {
+		dfs_visit(0, s, start[x], reverse_i);
+	}
 
-	transform(visited.begin(), visited.end(), visited.begin(),
-	  logical_not<big_bool>());
+// Invert to pre-visit nodes which can't be reached.
+	s.invert();
 
 	MAP(x, start.size()) {
 		vec[start[x]] = 0;
-		max_depth_recurse(vec, visited, start[x], reverse_i);
+		top_sort_visit(0, &vec, s, start[x], reverse_i);
 	}
+}
 
-	return vec;
+/*===========================================================================*/
+void RawGraph::levelize(levels_type & lv) const {
+	const long v_cnt = vertex_.size();
+	lv.depth.assign(v_cnt, 0);
+	lv.rank.resize(v_cnt);
+	lv.height = 0;
+	lv.width = 0;
+
+// Kahn's algorithm.  A vertex's depth is final when it is dequeued.
+	RVector<long> in_left(v_cnt);
+	RVector<long> queue;
+	queue.reserve(v_cnt);
+
+	MAP(x, v_cnt) {
+		in_left[x] = adj_size(x, true);
+		if (! in_left[x]) {
+			queue.push_back(x);
+		}
+	}
+
+	MAP(x, queue.size()) {
+		const int next_depth = lv.depth[queue[x]] + 1;
+
+		MAP(y, adj_size(queue[x], false)) {
+			const long to = adj(queue[x], y, false);
+			lv.depth[to] = max(lv.depth[to], next_depth);
+
+			if (! --in_left[to]) {
+				queue.push_back(to);
+			}
+		}
+	}
+
+	RASSERT(queue.size() == v_cnt);
+
+	MAP(x, v_cnt) {
+		lv.height = max(lv.height, lv.depth[x] + 1);
+	}
+
+	RVector<int> level_cnt(lv.height, 0);
+	MAP(x, v_cnt) {
+		lv.rank[x] = level_cnt[lv.depth[x]]++;
+		lv.width = max(lv.width, lv.rank[x] + 1);
+	}
 }
 
 /*===========================================================================*/
@@ -439,172 +727,174 @@ void RawGraph::self_check() const {
 }
 
 /*===========================================================================*/
-bool RawGraph::cyclic_recurse(RVector<big_bool> & visited,
-const vertex_index start, const vertex_index branch) const {
-	visited[branch] = true;
-	MAP(x, vertex(branch)->out_.size()) {
-		vertex_index to_vertex = edge(vertex(branch)->out_[x])->to_;
-
-		if (to_vertex == start)
-			return true;
-
-		if (! visited[to_vertex])
-			if (cyclic_recurse(visited, start, to_vertex))
-				return true;
+void RawGraph::traversal_scratch::begin(const long v_cnt) {
+	if (static_cast<long>(mark_.size()) < v_cnt) {
+		mark_.resize(v_cnt, 0L);
 	}
-	return false;
-}
 
-/*===========================================================================*/
-void RawGraph::dfs_recurse(RVector<vertex_index> & vec,
-RVector<big_bool> & visited, const vertex_index branch,
-bool reverse_i) const {
-	visited[branch] = true;
-	vec.push_back(branch);
-
-	if (reverse_i) {
-		MAP(x, vertex(branch)->in_.size()) {
-			vertex_index next_index = edge(vertex(branch)->in_[x])->from_;
-			if (! visited[next_index]) {
-				dfs_recurse(vec, visited, next_index, reverse_i);
-			}
-		}
-	} else {
-		MAP(x, vertex(branch)->out_.size()) {
-			vertex_index next_index = edge(vertex(branch)->out_[x])->to_;
-			if (! visited[next_index]) {
-				dfs_recurse(vec, visited, next_index, reverse_i);
-			}
-		}
-	}
+	epoch_ += 2;
+	inverted_ = false;
+	stack_.clear();
+	pending_.clear();
 }
 
 /*===========================================================================*/
-void RawGraph::bfs_recurse(RVector<vertex_index> & vec,
-RVector<big_bool> & visited, const vertex_index branch,
-bool reverse_i) const {
-	RVector<vertex_index> stack;
+bool RawGraph::cyclic_visit(RVector<vertex_index> * cycle,
+traversal_scratch & s, const vertex_index start) const {
+	s.enter(start);
+	s.push(start);
+
+	while (! s.stack_.empty()) {
+		const long branch = s.stack_[s.stack_.size() - 2];
+		long & x = s.stack_.back();
+
+		if (x == adj_size(branch, false)) {
+			s.see(branch);
+			s.pop();
+			continue;
+		}
 
-	if (reverse_i) {
-		MAP(x, vertex(branch)->in_.size()) {
-			vertex_index next_index = edge(vertex(branch)->in_[x])->from_;
+		const long to_vertex = adj(branch, x++, false);
+		if (s.open(to_vertex)) {
+// The open vertices on the stack, from to_vertex up, are the cycle.
+			if (cycle) {
+				long y = s.stack_.size() - 2;
+				while (s.stack_[y] != to_vertex)
+					y -= 2;
 
-			if (! visited[next_index]){
-				visited[next_index] = true;
-				vec.push_back(next_index);
-				stack.push_back(next_index);
+				for (; y < static_cast<long>(s.stack_.size()); y += 2)
+					cycle->push_back(s.stack_[y]);
 			}
+			return true;
 		}
-	} else {
-		MAP(x, vertex(branch)->out_.size()) {
-			vertex_index next_index = edge(vertex(branch)->out_[x])->to_;
 
-			if (! visited[next_index]){
-				visited[next_index] = true;
-				vec.push_back(next_index);
-				stack.push_back(next_index);
-			}
+		if (! s.seen(to_vertex)) {
+			s.enter(to_vertex);
+			s.push(to_vertex);
 		}
 	}
-
-	MAP(x, stack.size()) {
-		bfs_recurse(vec, visited, stack[x], reverse_i);
-	}
+	return false;
 }
 
 /*===========================================================================*/
-void RawGraph::top_sort_recurse(RVector<vertex_index> & vec,
-RVector<big_bool> & visited, const vertex_index branch,
-bool reverse_i) const {
-// If any of the parents haven't been visited yet, stop exploring this path.
-	if (reverse_i) {
-		MAP(x, vertex(branch)->out_.size())
-			if (! visited[edge(vertex(branch)->out_[x])->to_])
-				return;
-	} else {
-		MAP(x, vertex(branch)->in_.size())
-			if (! visited[edge(vertex(branch)->in_[x])->from_])
-				return;
-	}
+void RawGraph::dfs_visit(RVector<vertex_index> * vec,
+traversal_scratch & s, const vertex_index start, bool reverse_i) const {
+	s.see(start);
+	if (vec)
+		vec->push_back(start);
+
+	s.push(start);
+	while (! s.stack_.empty()) {
+		const long branch = s.stack_[s.stack_.size() - 2];
+		long & x = s.stack_.back();
+
+		if (x == adj_size(branch, reverse_i)) {
+			s.pop();
+			continue;
+		}
 
-	visited[branch] = true;
-	vec.push_back(branch);
+		const long next_index = adj(branch, x++, reverse_i);
+		if (! s.seen(next_index)) {
+			s.see(next_index);
+			if (vec)
+				vec->push_back(next_index);
 
-	if (reverse_i) {
-		MAP(x, vertex(branch)->in_.size()) {
-			vertex_index next_index = edge(vertex(branch)->in_[x])->from_;
-			if (! visited[next_index])
-				top_sort_recurse(vec, visited, next_index, reverse_i);
-		}
-	} else {
-		MAP(x, vertex(branch)->out_.size()) {
-			vertex_index next_index = edge(vertex(branch)->out_[x])->to_;
-			if (! visited[next_index])
-				top_sort_recurse(vec, visited, next_index, reverse_i);
+			s.push(next_index);
 		}
 	}
 }
 
 /*===========================================================================*/
-void RawGraph::outward_crawl_recurse(RVector<vertex_index> & vec,
-RVector<big_bool> & visited, vertex_index branch) const {
-	RVector<vertex_index> stack;
-
-	MAP(x, vertex(branch)->in_.size()) {
-		vertex_index next_index = edge(vertex(branch)->in_[x])->from_;
-
-		if (! visited[next_index]){
-			visited[next_index] = true;
-			vec.push_back(next_index);
-			stack.push_back(next_index);
+void RawGraph::bfs_visit(RVector<vertex_index> & vec,
+traversal_scratch & s, const vertex_index start, bool reverse_i,
+bool both) const {
+/* Each vertex's unvisited neighbours are listed, then each of them is
+expanded in turn before the next, as the recursive version did.  A frame is
+the range of pending_ still to expand. */
+	bfs_expand(vec, s, start, reverse_i, both);
+
+	while (! s.stack_.empty()) {
+		long & x = s.stack_[s.stack_.size() - 2];
+
+		if (x == s.stack_.back()) {
+			s.pop();
+			continue;
 		}
+
+		const long branch = s.pending_[x++];
+		bfs_expand(vec, s, branch, reverse_i, both);
 	}
+}
+
+/*===========================================================================*/
+void RawGraph::bfs_expand(RVector<vertex_index> & vec,
+traversal_scratch & s, const vertex_index branch, bool reverse_i,
+bool both) const {
+	const long begin = s.pending_.size();
+
+// Crawls go against the edges, then along them.
+	MAP(pass, both ? 2 : 1) {
+		const bool dir = both ? ! pass : reverse_i;
 
-	MAP(x, vertex(branch)->out_.size()) {
-		vertex_index next_index = edge(vertex(branch)->out_[x])->to_;
+		MAP(x, adj_size(branch, dir)) {
+			const long next_index = adj(branch, x, dir);
 
-		if (! visited[next_index]){
-			visited[next_index] = true;
-			vec.push_back(next_index);
-			stack.push_back(next_index);
+			if (! s.seen(next_index)) {
+				s.see(next_index);
+				vec.push_back(next_index);
+				s.pending_.push_back(next_index);
+			}
 		}
 	}
 
-	MAP(x, stack.size()) {
-		outward_crawl_recurse(vec, visited, stack[x]);
+	s.stack_.push_back(begin);
+	s.stack_.push_back(s.pending_.size());
+}
+
+/*===========================================================================*/
+bool RawGraph::parents_seen(const traversal_scratch & s,
+const vertex_index branch, bool reverse_i) const {
+	MAP(x, adj_size(branch, ! reverse_i)) {
+		if (! s.seen(adj(branch, x, ! reverse_i)))
+			return false;
 	}
+	return true;
 }
 
 /*===========================================================================*/
-void RawGraph::max_depth_recurse(RVector<int> & vec,
-RVector<big_bool> & visited, const vertex_index branch,
+void RawGraph::top_sort_visit(RVector<vertex_index> * vec,
+RVector<int> * depth, traversal_scratch & s, const vertex_index start,
 bool reverse_i) const {
 // If any of the parents haven't been visited yet, stop exploring this path.
-	if (reverse_i) {
-		MAP(x, vertex(branch)->out_.size())
-			if (! visited[edge(vertex(branch)->out_[x])->to_])
-				return;
-	} else {
-		MAP(x, vertex(branch)->in_.size())
-			if (! visited[edge(vertex(branch)->in_[x])->from_])
-				return;
-	}
+	if (! parents_seen(s, start, reverse_i))
+		return;
+
+	s.see(start);
+	if (vec)
+		vec->push_back(start);
 
-	visited[branch] = true;
+	s.push(start);
+	while (! s.stack_.empty()) {
+		const long branch = s.stack_[s.stack_.size() - 2];
+		long & x = s.stack_.back();
 
-	if (reverse_i) {
-		MAP(x, vertex(branch)->in_.size()) {
-			vertex_index next_index = edge(vertex(branch)->in_[x])->from_;
-			vec[next_index] = max(vec[next_index], vec[branch] + 1);
-			if (! visited[next_index])
-				max_depth_recurse(vec, visited, next_index, reverse_i);
+		if (x == adj_size(branch, reverse_i)) {
+			s.pop();
+			continue;
 		}
-	} else {
-		MAP(x, vertex(branch)->out_.size()) {
-			vertex_index next_index = edge(vertex(branch)->out_[x])->to_;
-			vec[next_index] = max(vec[next_index], vec[branch] + 1);
-			if (! visited[next_index])
-				max_depth_recurse(vec, visited, next_index, reverse_i);
+
+		const long next_index = adj(branch, x++, reverse_i);
+		if (depth) {
+			(*depth)[next_index] =
+				max((*depth)[next_index], (*depth)[branch] + 1);
+		}
+
+		if (! s.seen(next_index) && parents_seen(s, next_index, reverse_i)) {
+			s.see(next_index);
+			if (vec)
+				vec->push_back(next_index);
+
+			s.push(next_index);
 		}
 	}
 }
@@ -653,6 +943,162 @@ WGraph::edge_weight(edge_index e) const {
 	return (*this)(e);
 }
 
+/*###########################################################################*/
+namespace {
+
+struct position_less {
+	position_less(const RVector<long> & ord) : ord_(ord) {}
+	bool operator()(long a, long b) const { return ord_[a] < ord_[b]; }
+		const RVector<long> & ord_;
+};
+
+}
+
+/*===========================================================================*/
+TopOrder::TopOrder(const RawGraph & g) :
+	graph_(g),
+	ord_(g.size_vertex(), -1L),
+	vert_(),
+	visited_(g.size_vertex(), false),
+	forward_(),
+	backward_(),
+	stack_(),
+	pool_()
+{
+// Kahn's algorithm.
+	RVector<long> in_left(g.size_vertex());
+	MAP(x, g.size_vertex()) {
+		in_left[x] = g.vertex(x)->size_in();
+		if (! in_left[x]) {
+			vert_.push_back(x);
+		}
+	}
+
+	MAP(x, vert_.size()) {
+		RawGraph::const_vertex_iterator v = g.vertex(vert_[x]);
+		ord_[vert_[x]] = x;
+
+		MAP(y, v->size_out()) {
+			long to = g.edge(v->out(y))->to();
+			if (! --in_left[to]) {
+				vert_.push_back(to);
+			}
+		}
+	}
+
+	RASSERT(vert_.size() == g.size_vertex());
+}
+
+/*===========================================================================*/
+bool TopOrder::add_edge(const vertex_index from, const vertex_index to) {
+	if (from == to)
+		return false;
+
+	const long upper = ord_[from];
+	const long lower = ord_[to];
+
+	if (lower > upper)
+		return true;
+
+	forward_.clear();
+	backward_.clear();
+
+	bool acyclic = visit_forward(to, upper);
+	if (acyclic) {
+		visit_backward(from, lower);
+		reorder();
+	}
+
+	MAP(x, forward_.size())
+		visited_[forward_[x]] = false;
+
+	MAP(x, backward_.size())
+		visited_[backward_[x]] = false;
+
+	return acyclic;
+}
+
+/*===========================================================================*/
+bool TopOrder::visit_forward(const long start, const long upper) {
+// Vertices reachable from start which are ordered before upper.
+	stack_.clear();
+	stack_.push_back(start);
+	visited_[start] = true;
+	forward_.push_back(start);
+
+	while (! stack_.empty()) {
+		RawGraph::const_vertex_iterator v = graph_.vertex(stack_.back());
+		stack_.pop_back();
+
+		MAP(x, v->size_out()) {
+			long next = graph_.edge(v->out(x))->to();
+
+			if (ord_[next] == upper)
+				return false;
+
+			if (! visited_[next] && ord_[next] < upper) {
+				visited_[next] = true;
+				forward_.push_back(next);
+				stack_.push_back(next);
+			}
+		}
+	}
+
+	return true;
+}
+
+/*===========================================================================*/
+void TopOrder::visit_backward(const long start, const long lower) {
+// Vertices which reach start and are ordered after lower.
+	stack_.clear();
+	stack_.push_back(start);
+	visited_[start] = true;
+	backward_.push_back(start);
+
+	while (! stack_.empty()) {
+		RawGraph::const_vertex_iterator v = graph_.vertex(stack_.back());
+		stack_.pop_back();
+
+		MAP(x, v->size_in()) {
+			long next = graph_.edge(v->in(x))->from();
+
+			if (! visited_[next] && ord_[next] > lower) {
+				visited_[next] = true;
+				backward_.push_back(next);
+				stack_.push_back(next);
+			}
+		}
+	}
+}
+
+/*===========================================================================*/
+void TopOrder::reorder() {
+// Reuse the affected positions: ancestors of from first, then descendants
+// of to, each group keeping its relative order.
+	sort(backward_.begin(), backward_.end(), position_less(ord_));
+	sort(forward_.begin(), forward_.end(), position_less(ord_));
+
+	pool_.clear();
+	MAP(x, backward_.size())
+		pool_.push_back(ord_[backward_[x]]);
+
+	MAP(x, forward_.size())
+		pool_.push_back(ord_[forward_[x]]);
+
+	sort(pool_.begin(), pool_.end());
+
+	long p = 0;
+	MAP(x, backward_.size()) {
+		ord_[backward_[x]] = pool_[p];
+		vert_[pool_[p++]] = backward_[x];
+	}
+
+	MAP(x, forward_.size()) {
+		ord_[forward_[x]] = pool_[p];
+		vert_[pool_[p++]] = forward_[x];
+	}
+}
+
 /*###########################################################################*/
 void Graph_test() {
 	Graph<int, int> g1;
@@ -661,6 +1107,9 @@ void Graph_test() {
 	g1.rswap(g2);
 
 	typedef RawGraph::vertex_index vi;
+	STATIC_ASSERT(sizeof(vi) == sizeof(long));
+	STATIC_ASSERT(sizeof(RawGraph::edge_index) == sizeof(long));
+
 	vi v0 = g1.add_vertex(0);
 	vi v1 = g1.add_vertex(1);
 	vi v2 = g1.add_vertex(2);
@@ -686,6 +1135,77 @@ void Graph_test() {
 	RVector<RawGraph::vertex_index> rtsrt = g1.top_sort(dl, true);
 	cout << "Graph: " << rtsrt << "\n";
 	RASSERT(rtsrt.size() == g1.size_vertex());
+
+	TopOrder order(g1);
+	RASSERT(! order.add_edge(v2, v0));
+	RASSERT(! order.add_edge(v2, v2));
+	RASSERT(order.add_edge(v3, v1));
+	g1.add_edge(v3, v1, 3);
+	RASSERT(order.position(v3) < order.position(v1));
+	RASSERT(! order.add_edge(v2, v3));
+	RASSERT(! g1.cyclic());
+
+	RawGraph::levels_type lv;
+	g1.levelize(lv);
+	RASSERT(lv.depth[v1] == 2 && lv.depth[v2] == 3);
+	RASSERT(lv.height == 4 && lv.width == 1);
+
+	RawGraph::traversal_scratch scratch;
+	RVector<vi> listed;
+	g1.top_sort(listed, RVector<vi>(1, v0), false, scratch);
+	RASSERT(listed == g1.top_sort(v0));
+	g1.bfs(listed, RVector<vi>(1, v0), false, scratch);
+	RASSERT(listed == g1.bfs(v0));
+
+	const RVector<vi> order_listed = g1.dfs(v0);
+	g1.freeze();
+	RASSERT(g1.frozen() && g1.frozen_view().in_vertex[0] == v0);
+	RASSERT(g1.dfs(v0) == order_listed);
+	RASSERT(g1.max_depth(v0)[v2] == 3);
+
+	g1.erase_edge(0);
+	RASSERT(! g1.frozen());
+	RASSERT(g1.size_edge() == 3 && g1(0) == 3 && g1.edge(0)->from() == v3);
+	RASSERT(g1.vertex(v3)->out(0) == 0 && g1.vertex(v1)->in(0) == 0);
+
+	g1.erase_edge_ordered(1);
+	RASSERT(g1(0) == 3 && g1(1) == 2 && g1.edge(1)->from() == v0);
+	RASSERT(g1.vertex(v0)->out(0) == 1 && g1.vertex(v3)->in(0) == 1);
+	g1.self_check();
+
+// v0 -> v3 -> v1, and v2 alone.  Erasing v1 leaves v0 -> v3.
+	RVector<vi> gone(1, v1);
+	RVector<vi> v_map = g1.erase_vertices(gone);
+	RASSERT(v_map[v1] == RawGraph::INVALID_VINDEX && v_map[v3] == 2);
+	RASSERT(g1.size_vertex() == 3 && g1.size_edge() == 1);
+	RASSERT(g1[2] == 3 && g1(0) == 2 && g1.edge(0)->to() == 2);
+	RASSERT(g1.vertex(0)->out(0) == 0 && g1.vertex(2)->in(0) == 0);
+
+	RVector<RawGraph::edge_index> e_map =
+		g1.erase_edges(RVector<RawGraph::edge_index>(1, 0L));
+	RASSERT(e_map[0] == RawGraph::INVALID_EINDEX && ! g1.size_edge());
+	RASSERT(! g1.vertex(0)->size_out() && ! g1.vertex(2)->size_in());
+	g1.self_check();
+
+// A long chain.  Traversals keep their own stacks, not the call stack.
+	const long chain_len = 10000;
+	RawGraph chain;
+	chain.add_vertex();
+	MAP(x, chain_len - 1) {
+		chain.add_edge(x, chain.add_vertex());
+	}
+
+	RASSERT(chain.top_sort(0).size() == chain_len);
+	RASSERT(chain.max_depth(0)[chain_len - 1] == chain_len - 1);
+	RASSERT(chain.dfs(chain_len - 1, true).size() == chain_len);
+	RASSERT(! chain.cyclic());
+
+	RVector<vi> cycle;
+	RASSERT(! chain.find_cycle(cycle) && cycle.empty());
+	chain.add_edge(chain_len - 1, 5);
+	RASSERT(chain.cyclic(scratch) && chain.find_cycle(cycle, scratch));
+	RASSERT(cycle.size() == chain_len - 5 && cycle[0] == 5);
+	RASSERT(cycle.back() == chain_len - 1);
 }
 
 }
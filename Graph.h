@@ -16,6 +16,44 @@
 #include <iosfwd>
 
 namespace rstd {
+/*###########################################################################*/
+/* Vertex or edge index of a RawGraph.  A plain long with no interface bases,
+and so no hidden pointers, keeping edge lists as compact as RVector<long>.
+TAG keeps vertex and edge indexes from mixing. */
+
+template <int TAG>
+class GraphIndex {
+public:
+	GraphIndex(long indx) : index_(indx) {}
+	operator long() const { return index_; }
+	comp_type comp(const GraphIndex & a) const;
+
+	GraphIndex & operator++() { index_++; return *this; }
+	GraphIndex operator++(int);
+	GraphIndex & operator--() { index_--; return *this; }
+	GraphIndex operator--(int);
+	GraphIndex operator+=(GraphIndex i);
+	GraphIndex operator-=(GraphIndex i);
+	void print_to(std::ostream & os) const { os << index_; }
+
+private:
+		long index_;
+};
+
+template <int TAG>
+	GraphIndex<TAG> operator+(GraphIndex<TAG> a, GraphIndex<TAG> b);
+
+template <int TAG>
+	GraphIndex<TAG> operator-(GraphIndex<TAG> a, GraphIndex<TAG> b);
+
+/* Exact matches, which Interface.h's comparability test needs.  Mixed
+comparisons, and the rest, go through long. */
+template <int TAG>
+	bool operator==(GraphIndex<TAG> a, GraphIndex<TAG> b);
+
+template <int TAG>
+	bool operator<(GraphIndex<TAG> a, GraphIndex<TAG> b);
+
 /*###########################################################################*/
 // Base data-independent directed graph class.
 
@@ -30,48 +68,8 @@ class RawGraph :
 public:
 // Type safe indexes.
 
-	class vertex_index :
-		public Prints<vertex_index>,
-		public Comps<vertex_index>
-	{
-	public:
-		vertex_index(long indx) : index_(indx) {}
-		operator long() const { return index_; }
-		comp_type comp(const vertex_index & a) const;
-
-		vertex_index & operator++() { index_++; return *this; }
-		vertex_index operator++(int);
-		vertex_index & operator--() { index_--; return *this; }
-		vertex_index operator--(int);
-		vertex_index operator+=(vertex_index i);
-		vertex_index operator-=(vertex_index i);
-		void print_to(std::ostream & os) const { os << index_; }
-
-	private:
-			long index_;
-	};
-
-	class edge_index :
-		public Prints<edge_index>,
-		public Comps<edge_index>
-	{
-	public:
-		edge_index(long indx) : index_(indx) {}
-		operator long() const { return index_; }
-
-		comp_type comp(const edge_index & a) const;
-
-		edge_index & operator++() { index_++; return *this; }
-		edge_index operator++(int);
-		edge_index & operator--() { index_--; return *this; }
-		edge_index operator--(int);
-		edge_index operator+=(edge_index i);
-		edge_index operator-=(edge_index i);
-		void print_to(std::ostream & os) const { os << index_; }
-
-	private:
-			long index_;
-	};
+	typedef GraphIndex<0> vertex_index;
+	typedef GraphIndex<1> edge_index;
 
 	class vertex_type :
 		public Prints<RawGraph::vertex_type>
@@ -131,6 +129,75 @@ public:
 		friend class rstd::RawGraph;
 	};
 
+/* Longest-path levelization.  depth is the length of the longest path from
+any source.  rank numbers vertices of equal depth in index order.  height and
+width are one more than the largest depth and rank. */
+
+	class levels_type {
+	public:
+		levels_type() : depth(), rank(), height(0), width(0) {}
+
+			RVector<int> depth;
+			RVector<int> rank;
+			int height;
+			int width;
+	};
+
+/* Read-only adjacency in compressed sparse row form.  Vertex v's out
+neighbours are out_vertex[out_begin[v]] up to out_vertex[out_begin[v + 1]],
+in the order of its out edges, which are in out_edge.  Likewise for in. */
+
+	class frozen_type {
+	public:
+		frozen_type() : out_begin(), out_vertex(), out_edge(),
+			in_begin(), in_vertex(), in_edge() {}
+
+		void rswap(frozen_type & a);
+
+			RVector<long> out_begin;
+			RVector<long> out_vertex;
+			RVector<long> out_edge;
+			RVector<long> in_begin;
+			RVector<long> in_vertex;
+			RVector<long> in_edge;
+	};
+
+/* Working state for traversals, kept between calls to avoid reallocation.
+Visits are stamped with a per-traversal number, so nothing needs clearing
+between traversals.  The number below it marks vertices still open on the
+stack. */
+
+	class traversal_scratch {
+	public:
+		traversal_scratch() : mark_(), epoch_(0), inverted_(false),
+			stack_(), pending_() {}
+
+	private:
+// Starts a traversal of a graph with v_cnt vertices, with nothing visited.
+		void begin(long v_cnt);
+
+// Swaps visited and unvisited.  Vertices visited later stay visited.
+		void invert() { inverted_ = true; }
+
+		bool seen(long v) const { return (mark_[v] == epoch_) != inverted_; }
+		void see(long v) { mark_[v] = inverted_ ? 0 : epoch_; }
+
+		bool open(long v) const { return mark_[v] == epoch_ - 1; }
+		void enter(long v) { mark_[v] = epoch_ - 1; }
+
+		void push(long v) { stack_.push_back(v); stack_.push_back(0); }
+		void pop() { stack_.pop_back(); stack_.pop_back(); }
+
+			RVector<long> mark_;
+			long epoch_;
+			bool inverted_;
+// Pairs: a vertex and its next neighbour, or a range of pending_.
+			RVector<long> stack_;
+			RVector<long> pending_;
+
+		friend class rstd::RawGraph;
+	};
+
 private:
 	typedef RVector<vertex_type> v_impl;
 	typedef RVector<edge_type> e_impl;
@@ -156,7 +223,7 @@ public:
 
 // Construction
 	virtual ~RawGraph() {}
-	RawGraph() : vertex_(), edge_() {}
+	RawGraph() : vertex_(), edge_(), frozen_(false), csr_() {}
 	virtual self & operator=(const self & a);
 
 // Interface
@@ -167,16 +234,45 @@ public:
 	virtual void self_check_deep() const { self_check(); }
 
 // Modifiable
-// Invalidates indices.  This is slow, O(v * e).
+// Invalidates indices.  O(v + e).
 	virtual void erase_vertex(vertex_index i);
 
-// Invalidates indices.  This is slow, O(v * e).
+/* Moves the last edge into index i, keeping each vertex's edge order.
+O(degree of the endpoints). */
 	virtual void erase_edge(edge_index i);
 
+// Keeps the order of the other edges, renumbering them.  O(v + e).
+	virtual void erase_edge_ordered(edge_index i);
+
+/* Erases the listed vertices, with their edges, in one pass.  The rest keep
+their order.  Returns each old vertex's new index, or INVALID_VINDEX.
+O(v + e). */
+	virtual const RVector<vertex_index>
+		erase_vertices(const RVector<vertex_index> & v);
+
+// As erase_vertices, for edges.  Returns each old edge's new index.
+	virtual const RVector<edge_index>
+		erase_edges(const RVector<edge_index> & e);
+
 // Tries to eliminate any padding memory.  Run when size fixed.
 	virtual void pack_memory();
 	virtual void clear();
 
+/* Builds the frozen view, which traversals then use instead of the edge
+lists.  Any change to the graph drops it.  O(v + e). */
+	void freeze();
+	void thaw() { frozen_ = false; }
+
+// Builds a frozen view of the graph as it is now into csr.
+	void freeze_to(frozen_type & csr) const;
+
+/* Puts each vertex's edges in the order csr lists them, for restoring a saved
+graph.  Only out_begin, out_edge, in_begin and in_edge are read, and must hold
+the graph's own edges.  O(v + e). */
+	void order_edges(const frozen_type & csr);
+	bool frozen() const { return frozen_; }
+	const frozen_type & frozen_view() const { return csr_; }
+
 // Final
 	vertex_index size_vertex() const;
 	edge_index size_edge() const;
@@ -215,8 +311,15 @@ public:
 	edge_iterator edge(edge_index index);
 	const_edge_iterator edge(edge_index index) const;
 
-// Checks for cycles in the graph.
+// Checks for cycles in the graph.  One pass.  O(v + e).
 	bool cyclic() const;
+	bool cyclic(traversal_scratch & s) const;
+
+/* Puts the vertices of one cycle in cycle, in edge order, or leaves it empty
+if the graph is acyclic.  Returns true if a cycle was found. */
+	bool find_cycle(RVector<vertex_index> & cycle) const;
+	bool find_cycle(RVector<vertex_index> & cycle,
+		traversal_scratch & s) const;
 
 // Confirms that all vertices are connected to start.
 	bool connected(vertex_index start, bool reverse = false) const;
@@ -231,6 +334,11 @@ public:
 	const RVector<vertex_index>
 		dfs(RVector<vertex_index> start, bool reverse = false) const;
 
+/* The traversals taking a traversal_scratch put their result in vec and
+allocate nothing once vec and s have grown to the graph's size. */
+	void dfs(RVector<vertex_index> & vec, const RVector<vertex_index> & start,
+		bool reverse, traversal_scratch & s) const;
+
 // Returns a BFS-ordered RVector of vertex indices.
 	const RVector<vertex_index>
 		bfs(vertex_index start, bool reverse = false) const;
@@ -238,6 +346,9 @@ public:
 	const RVector<vertex_index>
 		bfs(RVector<vertex_index> start, bool reverse = false) const;
 
+	void bfs(RVector<vertex_index> & vec, const RVector<vertex_index> & start,
+		bool reverse, traversal_scratch & s) const;
+
 // Return every vertex's parent vertex and shortest path distance
 	const RVector<std::pair<vertex_index, double> >
 		shortest_path(vertex_index start) const;
@@ -249,10 +360,20 @@ public:
 	const RVector<vertex_index> top_sort(const RVector<vertex_index> & start,
 		bool reverse = false) const;
 
+	void top_sort(RVector<vertex_index> & vec,
+		const RVector<vertex_index> & start, bool reverse,
+		traversal_scratch & s) const;
+
 // BFS which ignores edge directions.
 	const RVector<vertex_index>
 		outward_crawl(vertex_index start) const;
 
+	void outward_crawl(RVector<vertex_index> & vec, vertex_index start,
+		traversal_scratch & s) const;
+
+// Levels every vertex in one topological pass.  O(v + e).  Acyclic only.
+	void levelize(levels_type & lv) const;
+
 // Disconnected vertices will have depths less than 0.
 	const RVector<int> max_depth(vertex_index start,
 		bool reverse = false) const;
@@ -260,47 +381,56 @@ public:
 	const RVector<int> max_depth(const RVector<vertex_index> & start,
 		bool reverse = false) const;
 
+	void max_depth(RVector<int> & vec, const RVector<vertex_index> & start,
+		bool reverse, traversal_scratch & s) const;
+
 		static const vertex_index INVALID_VINDEX;
 		static const edge_index INVALID_EINDEX;
 
 protected:
-	bool cyclic_recurse(RVector<big_bool> & visited,
-		vertex_index start, vertex_index branch) const;
+// Takes edge i out of its endpoints' edge lists.
+	void unlink_edge(edge_index i);
 
-	void dfs_recurse(RVector<vertex_index> & vec, RVector<big_bool> & visited,
-		vertex_index branch, bool reverse) const;
+// Number of neighbours of v, and neighbour x, against the edges if reverse.
+	long adj_size(vertex_index v, bool reverse) const;
+	long adj(vertex_index v, long x, bool reverse) const;
 
-	void bfs_recurse(RVector<vertex_index> & vec, RVector<big_bool> & visited,
-		vertex_index branch, bool reverse) const;
+/* Erases vertices v, their edges, and edges e.  Fills the old to new index
+maps. */
+	void compact(const RVector<vertex_index> & v,
+		const RVector<edge_index> & e, RVector<vertex_index> & v_map,
+		RVector<edge_index> & e_map);
 
-	void top_sort_recurse(RVector<vertex_index> & vec,
-		RVector<big_bool> & visited, vertex_index branch,
-		bool reverse) const;
+// Traversals from one start, sharing s with any earlier starts.
+	bool cyclic_visit(RVector<vertex_index> * cycle, traversal_scratch & s,
+		vertex_index start) const;
 
-	void outward_crawl_recurse(RVector<vertex_index> & vec,
-		RVector<big_bool> & visited, vertex_index branch) const;
+// Lists what is reached in vec, if given.
+	void dfs_visit(RVector<vertex_index> * vec, traversal_scratch & s,
+		vertex_index start, bool reverse) const;
 
-	void max_depth_recurse(RVector<int> & vec,
-		RVector<big_bool> & visited, vertex_index branch,
+// Both follows edges either way, as outward_crawl does.
+	void bfs_visit(RVector<vertex_index> & vec, traversal_scratch & s,
+		vertex_index start, bool reverse, bool both) const;
+
+	void bfs_expand(RVector<vertex_index> & vec, traversal_scratch & s,
+		vertex_index branch, bool reverse, bool both) const;
+
+	bool parents_seen(const traversal_scratch & s, vertex_index branch,
 		bool reverse) const;
 
+/* Visits each vertex once all its parents have been, listing it in vec and
+raising its children's depths, where given. */
+	void top_sort_visit(RVector<vertex_index> * vec, RVector<int> * depth,
+		traversal_scratch & s, vertex_index start, bool reverse) const;
+
 private:
 		v_impl vertex_;
 		e_impl edge_;
+		bool frozen_;
+		frozen_type csr_;
 };
 
-RawGraph::vertex_index operator+(RawGraph::vertex_index a,
-	RawGraph::vertex_index b);
-
-RawGraph::vertex_index operator-(RawGraph::vertex_index a,
-	RawGraph::vertex_index b);
-
-RawGraph::edge_index operator+(RawGraph::edge_index a,
-	RawGraph::edge_index b);
-
-RawGraph::edge_index operator-(RawGraph::edge_index a,
-	RawGraph::edge_index b);
-
 /*===========================================================================*/
 // Type-specific directed graph.
 
@@ -327,6 +457,13 @@ public:
 
 	virtual void erase_vertex(vertex_index i);
 	virtual void erase_edge(edge_index i);
+	virtual void erase_edge_ordered(edge_index i);
+
+	virtual const RVector<vertex_index>
+		erase_vertices(const RVector<vertex_index> & v);
+
+	virtual const RVector<edge_index>
+		erase_edges(const RVector<edge_index> & e);
 
 	virtual void pack_memory();
 	virtual void clear();
@@ -347,6 +484,10 @@ public:
 	const E & operator()(edge_index i) const { return e_data_[i]; }
 
 private:
+// Moves each kept item to its new index and drops the rest.
+	template <typename T, typename I>
+	static void compact_data(RVector<T> & data, const RVector<I> & map);
+
 		RVector<V> v_data_;
 		RVector<E> e_data_;
 };
@@ -358,6 +499,42 @@ public:
 	virtual double edge_weight(edge_index e) const;
 };
 
+/*===========================================================================*/
+/* Topological order of a DAG, kept current as arcs are added (Pearce and
+Kelly's dynamic topological sort).  Each arc is checked before it is added to
+the graph.  Work is proportional to the part of the order lying between the
+arc's endpoints, not to the size of the graph. */
+
+class TopOrder {
+	typedef RawGraph::vertex_index vertex_index;
+
+public:
+// The graph must be acyclic and must not gain vertices later.  O(v + e).
+	explicit TopOrder(const RawGraph & g);
+
+/* Returns false if from -> to would close a cycle.  Otherwise updates the
+order to allow the arc, which the caller then adds to the graph. */
+	bool add_edge(vertex_index from, vertex_index to);
+
+// Position of a vertex in the order.
+	long position(vertex_index v) const { return ord_[v]; }
+
+private:
+	bool visit_forward(long start, long upper);
+	void visit_backward(long start, long lower);
+	void reorder();
+
+		const RawGraph & graph_;
+// Vertex to position, position to vertex.
+		RVector<long> ord_;
+		RVector<long> vert_;
+		RVector<big_bool> visited_;
+		RVector<long> forward_;
+		RVector<long> backward_;
+		RVector<long> stack_;
+		RVector<long> pool_;
+};
+
 /*===========================================================================*/
 void Graph_test();
 
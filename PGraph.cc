@@ -21,9 +21,9 @@ using namespace std;
 using namespace rstd;
 
 // --------------------------------------------------
-void ResourceUse::print_to(ostream &os) const
+void ResourceUse::print_to(RWriter &out) const
 {
-	os << name_ << "(s/e = " << ts_ << "/" << te_ << ")";
+	out << name_ << "(s/e = " << ts_ << "/" << te_ << ")";
 }
 
 // --------------------------------------------------
@@ -34,40 +34,40 @@ Resource::Resource() :
 {}
 
 // --------------------------------------------------
-void Resource::print_to(ostream &os) const
+void Resource::print_to(RWriter &out) const
 {
-	os << endl << "@" << name_ << " {" << endl << "#";
+	out << '\n' << "@" << name_ << " {" << '\n' << "#";
 
 	MAP(x,attrib_.size())			// write attributes
-		os << "\t" << attrib_[x].name_ ;
-	os << endl;
+		out << "\t" << attrib_[x].name_ ;
+	out << '\n';
 	MAP(x,attrib_.size())
-		os << "\t" << attrib_[x].value_ ;
-	os << endl;
+		out << "\t" << attrib_[x].value_ ;
+	out << '\n';
 
 	// write type dependent lists
-	os << endl << "#\ttype\texec_time" << endl;
+	out << '\n' << "#\ttype\texec_time" << '\n';
 	MAP(x,exec_time_.size())
-		os << "\t" << x << "\t" << exec_time_[x] << endl;
+		out << "\t" << x << "\t" << exec_time_[x] << '\n';
 
-	os << "}" << endl;	// complete
+	out << "}" << '\n';	// complete
 }
 	
 // --------------------------------------------------
-void ResourceInstance::print_to(ostream &os) const
+void ResourceInstance::print_to(RWriter &out) const
 {
-	os	<< "# Instance Name " << name_
-		<< "  \t--resource_index= " << resource_indx_ << endl;
+	out	<< "# Instance Name " << name_
+		<< "  \t--resource_index= " << resource_indx_ << '\n';
 	double util = 0.0;
 	MAP(x,ru_.size())
 	{
-		os	<< "#  " << ru_[x].name_ << " \tstart/end:\t"
-			<< ru_[x].ts_ << " / " << ru_[x].te_ << endl;
+		out	<< "#  " << ru_[x].name_ << " \tstart/end:\t"
+			<< ru_[x].ts_ << " / " << ru_[x].te_ << '\n';
 		util += (ru_[x].te_ - ru_[x].ts_) / time_frame_;
 	}
-	os << "# Utilization = " << (100.0*util) << "%" << endl;
+	out << "# Utilization = " << (100.0*util) << "%" << '\n';
 
-	os << endl;
+	out << '\n';
 }
 // --------------------------------------------------
 	 
@@ -417,36 +417,38 @@ PGraph::PGraph( ostream &eps_out,
 
 /*===========================================================================*/
 void PGraph::print_to(ostream &os) const {
+	RWriter out(os);
+
 	MAP(x, pe_.size()) {
-		os << pe_[x];
+		pe_[x].print_to(out);
 	}
 
-	os << "\n# Known solution cost = " << cost_of_soln_ << endl;
-	os << "# Here's the known solution with " << pe_soln_.size() << " PEs" << endl;
+	out << "\n# Known solution cost = " << cost_of_soln_ << '\n';
+	out << "# Here's the known solution with " << pe_soln_.size() << " PEs" << '\n';
 	MAP(x, pe_soln_.size())
-		os << pe_soln_[x];
+		pe_soln_[x].print_to(out);
 
 	MAP(x, com_.size())
-		os << com_[x];
+		com_[x].print_to(out);
 
-	os << "\n# Here's the associated COM solution with "
-		<< com_soln_.size() << " COMs" << endl;
+	out << "\n# Here's the associated COM solution with "
+		<< com_soln_.size() << " COMs" << '\n';
 	MAP(x, com_soln_.size())
-		os << com_soln_[x];
+		com_soln_[x].print_to(out);
 
-	os << "@ARCDATASIZETABLE 0 {" << endl
-		<< "#  type	\tdata_size" << endl;
+	out << "@ARCDATASIZETABLE 0 {" << '\n'
+		<< "#  type	\tdata_size" << '\n';
 	MAP(x, arc_data_size_.size()) 
-		os << "  " << x << "\t" << arc_data_size_[x] << endl;
-	os << "}" << endl;
+		out << "  " << x << "\t" << arc_data_size_[x] << '\n';
+	out << "}" << '\n';
 
 	MAP(x, dag_.size()) {
-		os << "\n@TASK_GRAPH" << " " <<
+		out << "\n@TASK_GRAPH" << " " <<
 		  x << " {\n";
-		dag_[x].print_to(os);
+		dag_[x].print_to(out);
 	}
 
-	os << "\n\n";
+	out << "\n\n";
 }
 
 /*===========================================================================*/
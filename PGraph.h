@@ -6,6 +6,7 @@
 
 /*###########################################################################*/
 #include "RVector.h"
+#include "RWriter.h"
 #include "TG.h"
 
 #include <string>
@@ -41,9 +42,9 @@ private:
 					: name_(nm), ts_(start), te_(end) {};
 	std::string	name_;
 	double	ts_, te_;
-	void print_to(std::ostream &os) const;
+	void print_to(rstd::RWriter &out) const;
 	friend std::ostream &operator<<(std::ostream &os, /**/const ResourceUse &ru)
-	  {ru.print_to(os); return os;}
+	  {rstd::RWriter out(os); ru.print_to(out); return os;}
 };
 
 class Resource {
@@ -54,9 +55,9 @@ private:
 	rstd::RVector<ResourceAttrib>	attrib_;
 	rstd::RVector<double>			exec_time_;	// for PE resources only
 
-	void print_to(std::ostream &os) const;
+	void print_to(rstd::RWriter &out) const;
 	friend std::ostream &operator<<(std::ostream &os, /**/ const Resource &r)
-	  {r.print_to(os); return os;}
+	  {rstd::RWriter out(os); r.print_to(out); return os;}
 public:
 	Resource();
 	ResourceAttrib& GetAttrib(std::string s);
@@ -78,9 +79,9 @@ private:
 	double					time_frame_;
 	rstd::RVector<ResourceUse>	ru_;
 
-	void print_to(std::ostream &os) const;
+	void print_to(rstd::RWriter &out) const;
 	friend std::ostream &operator<<(std::ostream &os,const ResourceInstance &ri)
-	  {ri.print_to(os); return os;}
+	  {rstd::RWriter out(os); ri.print_to(out); return os;}
 };
 
 /*###########################################################################*/
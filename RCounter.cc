@@ -0,0 +1,26 @@
+// Copyright 2008 by Robert Dick.
+// All rights reserved.
+
+#include "RCounter.h"
+
+namespace rstd {
+using namespace std;
+
+/*###########################################################################*/
+RCounter::RCounter(const char * name) :
+	name_(name),
+	count_(0)
+{
+	registry().push_back(this);
+}
+
+/*===========================================================================*/
+// Built on first use, as counters in other files may be constructed first.
+RVector<RCounter *> &
+RCounter::registry() {
+	static RVector<RCounter *> counter;
+	return counter;
+}
+
+/*###########################################################################*/
+}
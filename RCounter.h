@@ -0,0 +1,38 @@
+// Copyright 2008 by Robert Dick.
+// All rights reserved.
+
+#ifndef R_COUNTER_H_
+#define R_COUNTER_H_
+
+/*###########################################################################*/
+#include "RVector.h"
+
+namespace rstd {
+/*===========================================================================*/
+/* A named, process-wide count of some event on a hot path.  Counters are
+defined at namespace scope and may be bumped from any thread. */
+
+class RCounter {
+public:
+	explicit RCounter(const char * name);
+
+	void add(long n = 1) { __sync_fetch_and_add(&count_, n); }
+	long count() const { return count_; }
+	const char * name() const { return name_; }
+
+// Every counter, in order of construction.
+	static const RVector<RCounter *> & all() { return registry(); }
+
+private:
+	RCounter(const RCounter &);
+	RCounter & operator=(const RCounter &);
+
+	static RVector<RCounter *> & registry();
+
+		const char * name_;
+		volatile long count_;
+};
+
+/*###########################################################################*/
+}
+#endif
@@ -8,6 +8,7 @@
 #include "Epsilon.h"
 #include "RVector.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cfloat>
 #include <iostream>
@@ -38,18 +39,154 @@ Portable to machines with 32 bit floating point numbers with 24 bit mantissas.
 Note that only the most significant 24 bits of the mantissa are guaranteed to
 be identical from machine to machine.
 
-Gaussian RVs are generated using the Box-Muller transformation.  This is not
-an approximation like the 12 sum approach.  True Gaussian RVs are generated.
+Gaussian RVs are generated using the Box-Muller transformation, or with
+set_gauss(ZIGGURAT) by the ziggurat method.  Neither is an approximation like
+the 12 sum approach.  True Gaussian RVs are generated.
 ############################################################################*/
 
 /*##########################################################################*/
+RGenEngine::~RGenEngine() {}
+
+/*===========================================================================*/
+namespace {
+
+uint64_t rotl(uint64_t x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+// C++98 has no 64-bit literals, so wide constants are built from halves.
+uint64_t u64(uint32_t hi, uint32_t lo) {
+	return (static_cast<uint64_t>(hi) << 32) | lo;
+}
+
+// Seed expander recommended for xoshiro.
+uint64_t splitmix64(uint64_t & x) {
+	uint64_t z = (x += u64(0x9e3779b9U, 0x7f4a7c15U));
+	z = (z ^ (z >> 30)) * u64(0xbf58476dU, 0x1ce4e5b9U);
+	z = (z ^ (z >> 27)) * u64(0x94d049bbU, 0x133111ebU);
+	return z ^ (z >> 31);
+}
+
+/*===========================================================================*/
+// Blackman and Vigna's xoshiro256**.
+
+class Xoshiro256ss : public RGenEngine {
+public:
+	Xoshiro256ss() { set_seed(1, 0); }
+	RGenEngine * clone() const { return new Xoshiro256ss(*this); }
+
+	void set_seed(uint32_t seed, uint64_t stream) {
+		uint64_t x = splitmix64(stream) ^ seed;
+		MAP(i, 4) {
+			s_[i] = splitmix64(x);
+		}
+	}
+
+	uint64_t next() {
+		const uint64_t result = rotl(s_[1] * 5, 7) * 9;
+		const uint64_t t = s_[1] << 17;
+
+		s_[2] ^= s_[0];
+		s_[3] ^= s_[1];
+		s_[1] ^= s_[2];
+		s_[0] ^= s_[3];
+		s_[2] ^= t;
+		s_[3] = rotl(s_[3], 45);
+
+		return result;
+	}
+
+private:
+		uint64_t s_[4];
+};
+
+/*===========================================================================*/
+/* Salmon et al.'s counter-based Philox4x32-10.  The key holds the seed and
+the low half of the stream, the counter's high half holds the rest of the
+stream.  Each block gives two draws. */
+
+class Philox4x32 : public RGenEngine {
+public:
+	Philox4x32() { set_seed(1, 0); }
+	RGenEngine * clone() const { return new Philox4x32(*this); }
+
+	void set_seed(uint32_t seed, uint64_t stream) {
+		key_[0] = seed;
+		key_[1] = static_cast<uint32_t>(stream);
+		ctr_[0] = ctr_[1] = 0;
+		ctr_[2] = static_cast<uint32_t>(stream >> 32);
+		ctr_[3] = 0;
+		have_ = 0;
+	}
+
+	uint64_t next() {
+		if (! have_) {
+			block();
+			have_ = 2;
+		}
+
+		const int i = 4 - 2 * have_--;
+		return u64(out_[i], out_[i + 1]);
+	}
+
+private:
+	void block() {
+		uint32_t c[4] = { ctr_[0], ctr_[1], ctr_[2], ctr_[3] };
+		uint32_t k0 = key_[0], k1 = key_[1];
+
+		MAP(r, 10) {
+			const uint64_t p0 = static_cast<uint64_t>(0xD2511F53U) * c[0];
+			const uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57U) * c[2];
+
+			const uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k0;
+			const uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k1;
+			c[0] = n0;
+			c[1] = static_cast<uint32_t>(p1);
+			c[2] = n2;
+			c[3] = static_cast<uint32_t>(p0);
+
+			k0 += 0x9E3779B9U;
+			k1 += 0xBB67AE85U;
+		}
+
+		MAP(i, 4) {
+			out_[i] = c[i];
+		}
+
+// 64-bit increment of the low half; the high half is the stream.
+		if (! ++ctr_[0])
+			++ctr_[1];
+	}
+
+		uint32_t key_[2];
+		uint32_t ctr_[4];
+		uint32_t out_[4];
+		int have_;
+};
+
+// [0, 1) with 53 bits.
+inline double to_flat01(uint64_t x) {
+	return (x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+}
+
+/*##########################################################################*/
+__thread RGen * RGen::bound_ = 0;
+
+/*===========================================================================*/
 RGen::~RGen() {}
 
 /*===========================================================================*/
 RGen::RGen(int seed) :
 	ip_(0), jp_(0),
 	c_(0), cd_(0), cm_(0),
-	u_(new RVector<float>(97))
+	u_(new RVector<float>(97)),
+	engine_type_(MARSAGLIA),
+	engine_(),
+	gauss_type_(BOX_MULLER),
+	gauss_held_(false),
+	gauss_next_(0.0)
 {
 	set_seed(seed);
 }
@@ -62,10 +199,20 @@ void RGen::rswap(self & a) {
 	rstd::rswap(cd_, a.cd_);
 	rstd::rswap(cm_, a.cm_);
 	rstd::rswap(u_, a.u_);
+	rstd::rswap(engine_type_, a.engine_type_);
+	rstd::rswap(engine_, a.engine_);
+	rstd::rswap(gauss_type_, a.gauss_type_);
+	rstd::rswap(gauss_held_, a.gauss_held_);
+	rstd::rswap(gauss_next_, a.gauss_next_);
 }
 
 /*===========================================================================*/
 void RGen::set_seed(int seed) {
+	if (engine_.get()) {
+		engine_->set_seed(seed, 0);
+		return;
+	}
+
 	int ij = seed / 30082;
 	int kl = seed - 30082 * ij;
 
@@ -77,6 +224,37 @@ void RGen::set_seed(int seed) {
 	set_seed(i, j, k, l);
 }
 
+/*===========================================================================*/
+namespace {
+
+// 32-bit avalanche mix (MurmurHash3 finalizer).
+unsigned long mix32(unsigned long h) {
+	h &= 0xffffffffUL;
+	h ^= h >> 16;
+	h = (h * 0x85ebca6bUL) & 0xffffffffUL;
+	h ^= h >> 13;
+	h = (h * 0xc2b2ae35UL) & 0xffffffffUL;
+	h ^= h >> 16;
+	return h;
+}
+
+}
+
+void RGen::set_seed(int seed, long stream) {
+// Engine stream 0 is the one set_seed(seed) gives; stream s is s + 1.
+	RASSERT(stream != -1);
+	if (engine_.get()) {
+		engine_->set_seed(seed, static_cast<uint64_t>(stream) + 1);
+		return;
+	}
+
+	unsigned long h = mix32(static_cast<unsigned long>(seed));
+	h = mix32(h + static_cast<unsigned long>(stream) * 0x9e3779b9UL);
+
+// Every seed in [0, 177 * 177 * 30082) gives a distinct (i, j, k, l).
+	set_seed(static_cast<int>(h % (177UL * 177UL * 30082UL)));
+}
+
 /*===========================================================================*/
 void RGen::set_seed(int i, int j, int k, int l) {
 	MAP(ii, u_->size()) {
@@ -107,8 +285,25 @@ void RGen::set_seed(int i, int j, int k, int l) {
 	jp_ = 32;
 }
 
+/*===========================================================================*/
+void RGen::set_engine(Engine e) {
+	engine_type_ = e;
+
+	switch (e) {
+	case MARSAGLIA: engine_.reset(); break;
+	case XOSHIRO256SS: engine_.reset(new Xoshiro256ss); break;
+	case PHILOX4X32: engine_.reset(new Philox4x32); break;
+	default: Rabort();
+	}
+
+	set_seed(1);
+}
+
 /*===========================================================================*/
 double RGen::flat01() {
+	if (engine_.get())
+		return to_flat01(engine_->next());
+
 	float uni = (*u_)[ip_] - (*u_)[jp_];
 	if (uni < 0.0)
 		uni += 1.0F;
@@ -129,35 +324,253 @@ double RGen::flat01() {
 }
 
 /*===========================================================================*/
-double RGen::gauss01() {
-// Mean 0, variance 1.
-		static int recalc=1;
-		double in_a, in_b;
-		double out_a;
-		static double out_b;
-		double modifier;
-		double compile_b;
-
-		if (recalc) {
+void RGen::flat01_fill(double * out, long n) {
+/* Same recurrence as flat01(), in two passes.  All values are multiples of
+2^-24 in (-1, 1), so each float operation is exact and the order does not
+matter.  The lagged table update u[i] -= u[i + 33] only depends on a value
+written 33 draws earlier, so runs of up to 33 draws which do not wrap are
+free of dependencies and the loop can be vectorized.  The carry is a cheap
+serial pass. */
+	if (engine_.get()) {
+		RGenEngine & e = *engine_;
+		MAP(x, n) {
+			out[x] = to_flat01(e.next());
+		}
+
+		return;
+	}
+
+	RVector<float> & u = *u_;
+	long done = 0;
+
+	while (done < n) {
+		const long run = min(n - done, min(33L, min<long>(ip_, jp_) + 1));
+		float * p = &u[ip_] - run + 1;
+		const float * q = &u[jp_] - run + 1;
+		double * o = out + done;
+
+		for (long x = run - 1; x >= 0; --x) {
+			float uni = p[x] - q[x];
+			uni += uni < 0.0F ? 1.0F : 0.0F;
+			p[x] = uni;
+			*o++ = uni;
+		}
+
+		ip_ -= run;
+		jp_ -= run;
+		if (ip_ < 0) ip_ = 96;
+		if (jp_ < 0) jp_ = 96;
+		done += run;
+	}
+
+	float c = c_;
+	MAP(x, n) {
+		c -= cd_;
+		if (c < 0.0F) c += cm_;
+
+		float uni = static_cast<float>(out[x]) - c;
+		if (uni < 0.0F) uni += 1.0F;
+		out[x] = uni;
+	}
+	c_ = c;
+
+	RASSERT(! n || *max_element(out, out + n) < 1.0);
+}
+
+/*===========================================================================*/
+void RGen::flat01_fill(RVector<double> & out) {
+	if (out.size())
+		flat01_fill(&out[0], out.size());
+}
+
+/*===========================================================================*/
+void RGen::flat_range_d_fill(RVector<double> & out, double low, double high) {
+	RASSERT(low < high);
+	flat01_fill(out);
+
+	MAP(x, out.size()) {
+		out[x] = (high - low) * out[x] + low;
+	}
+}
+
+/*===========================================================================*/
+void RGen::flat_range_l_fill(RVector<long> & out, long low, long high) {
+	RASSERT(low < high);
+	RVector<double> tmp(out.size());
+	flat01_fill(tmp);
+
+	MAP(x, out.size()) {
+		out[x] = long((high - low) * tmp[x] + low);
+		RASSERT(out[x] >= low && out[x] < high);
+	}
+}
+
+/*===========================================================================*/
+double RGen::box_muller(double & second) {
 // Range from (0:1], not [0:1).  Had to change this to prevent log(0).
-			in_a = 1.0 - flat01();
-			in_b = flat01();
-		
-			modifier = sqrt(-2.0 * log(in_a));
-			compile_b = 2.0 * PI * in_b;
-		
-			out_a = modifier * cos(compile_b);
-			out_b = modifier * sin(compile_b);
-
-			recalc = 0;
-
-			RASSERT(rstd::isfinite(out_a));
-			return out_a;
+	double in_a = 1.0 - flat01();
+	double in_b = flat01();
+
+	double modifier = sqrt(-2.0 * log(in_a));
+	double compile_b = 2.0 * PI * in_b;
+
+	second = modifier * sin(compile_b);
+	RASSERT(rstd::isfinite(second));
+
+	double first = modifier * cos(compile_b);
+	RASSERT(rstd::isfinite(first));
+	return first;
+}
+
+/*===========================================================================*/
+namespace {
+
+// Doornik, "An Improved Ziggurat Method to Generate Normal Random Samples".
+const int ZIG_C = 128;
+const double ZIG_R = 3.442619855899;
+const double ZIG_V = 9.91256303526217e-3;
+
+class ZigTable {
+public:
+	ZigTable() {
+		double f = exp(-0.5 * ZIG_R * ZIG_R);
+		x[0] = ZIG_V / f;
+		x[1] = ZIG_R;
+		x[ZIG_C] = 0.0;
+
+		for (int i = 2; i < ZIG_C; ++i) {
+			x[i] = sqrt(-2.0 * log(ZIG_V / x[i - 1] + f));
+			f = exp(-0.5 * x[i] * x[i]);
+		}
+
+		MAP(i, ZIG_C) {
+			r[i] = x[i + 1] / x[i];
+		}
+	}
+
+// Block edges and the ratio of each block's inner to outer edge.
+		double x[ZIG_C + 1];
+		double r[ZIG_C];
+};
+
+const ZigTable zig;
+
+}
+
+double RGen::ziggurat() {
+	for (;;) {
+// A 64-bit engine gives the sign and offset and, from the bits flat01() drops,
+// the strip in one draw.  The Marsaglia table needs two.
+		double u;
+		int i;
+		if (engine_.get()) {
+			const uint64_t bits = engine_->next();
+			u = 2.0 * to_flat01(bits) - 1.0;
+			i = static_cast<int>(bits & (ZIG_C - 1));
+		} else {
+			u = 2.0 * flat01() - 1.0;
+			i = static_cast<int>(flat01() * ZIG_C);
 		}
 
-		recalc = 1;
-		RASSERT(rstd::isfinite(out_b));
-		return out_b;
+// Inside a rectangle.
+		if (fabs(u) < zig.r[i])
+			return u * zig.x[i];
+
+// The base strip: sample the tail beyond ZIG_R.
+		if (! i) {
+			double x, y;
+			do {
+				x = log(1.0 - flat01()) / ZIG_R;
+				y = log(1.0 - flat01());
+			} while (-2.0 * y < x * x);
+
+			return u < 0.0 ? x - ZIG_R : ZIG_R - x;
+		}
+
+// In a wedge.
+		const double x = u * zig.x[i];
+		const double f0 = exp(-0.5 * (zig.x[i] * zig.x[i] - x * x));
+		const double f1 = exp(-0.5 * (zig.x[i + 1] * zig.x[i + 1] - x * x));
+
+		if (f1 + flat01() * (f0 - f1) < 1.0)
+			return x;
+	}
+}
+
+/*===========================================================================*/
+void RGen::set_gauss(Gauss g) {
+	gauss_type_ = g;
+	gauss_held_ = false;
+}
+
+/*===========================================================================*/
+double RGen::gauss01() {
+// Mean 0, variance 1.
+	if (gauss_type_ == ZIGGURAT)
+		return ziggurat();
+
+	if (gauss_held_) {
+		gauss_held_ = false;
+		return gauss_next_;
+	}
+
+	gauss_held_ = true;
+	return box_muller(gauss_next_);
+}
+
+/*===========================================================================*/
+void RGen::gauss_fill(RVector<double> & out) {
+	const long n = out.size();
+	long x = 0;
+
+	if (gauss_type_ == ZIGGURAT) {
+		for (; x < n; ++x)
+			out[x] = ziggurat();
+
+		return;
+	}
+
+	if (x < n && gauss_held_) {
+		gauss_held_ = false;
+		out[x++] = gauss_next_;
+	}
+
+// Whole pairs from one bulk draw of uniforms.
+	const long pairs = (n - x) / 2;
+	RVector<double> flat(2 * pairs);
+	flat01_fill(flat);
+
+	MAP(p, pairs) {
+		const double modifier = sqrt(-2.0 * log(1.0 - flat[2 * p]));
+		const double compile_b = 2.0 * PI * flat[2 * p + 1];
+
+		out[x++] = modifier * cos(compile_b);
+		out[x++] = modifier * sin(compile_b);
+	}
+
+	if (x < n)
+		out[x] = gauss01();
+}
+
+/*===========================================================================*/
+void RGen::gauss_mean_d_fill(RVector<double> & out, double mean,
+double variance) {
+	gauss_fill(out);
+
+	MAP(x, out.size()) {
+		out[x] = out[x] * variance + mean;
+		RASSERT(rstd::isfinite(out[x]));
+	}
+}
+
+/*===========================================================================*/
+void RGen::gauss_mean_half_d_fill(RVector<double> & out, double mean,
+double variance) {
+	gauss_fill(out);
+
+	MAP(x, out.size()) {
+		out[x] = mean + variance * abs(out[x]);
+	}
 }
 
 /*===========================================================================*/
@@ -209,6 +622,9 @@ bool RGen::flip(double cut_off) {
 /*===========================================================================*/
 RGen &
 RGen::gen() {
+	if (bound_)
+		return *bound_;
+
 	static RGen g;
 	return g;
 }
@@ -277,6 +693,35 @@ void RGen_test() {
 	g.set_seed(1024);
 	MAP(x, 25)
 		gen_confirm(g.gauss_mean_d(-1024, 2048), L_data10[x]);
+
+// The bulk fill must continue the same sequence, across table wraps.
+	RGen h;
+	g.set_seed(7);
+	h.set_seed(7);
+	for (long n = 0; n < 300; n += 37) {
+		RVector<double> fill(n);
+		h.flat_range_d_fill(fill, -5.0, 3.0);
+		MAP(x, n)
+			RASSERT(fill[x] == g.flat_range_d(-5.0, 3.0));
+
+		RVector<long> fill_l(n);
+		h.flat_range_l_fill(fill_l, 3, 17);
+		MAP(x, n)
+			RASSERT(fill_l[x] == g.flat_range_l(3, 17));
+	}
+	RASSERT(g.flat01() == h.flat01());
+
+// Bulk Gaussians continue the same sequence, including a kept value.
+	MAP(z, 2) {
+		g.set_gauss(z ? RGen::ZIGGURAT : RGen::BOX_MULLER);
+		h.set_gauss(z ? RGen::ZIGGURAT : RGen::BOX_MULLER);
+		for (long n = 0; n < 20; n += 3) {
+			RVector<double> fill(n);
+			h.gauss_mean_d_fill(fill, 3.0, 2.0);
+			MAP(x, n)
+				RASSERT(fill[x] == g.gauss_mean_d(3.0, 2.0));
+		}
+	}
 #endif
 
 #if 0
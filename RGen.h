@@ -10,8 +10,27 @@
 #include "RVector.h"
 
 #include <iosfwd>
+#include <stdint.h>
 
 namespace rstd {
+/*===========================================================================*/
+/* Source of uniform random bits for RGen, used in place of RGen's own 24-bit
+Marsaglia table. */
+
+class RGenEngine :
+	public Clones<RGenEngine>
+{
+public:
+	virtual ~RGenEngine();
+	virtual RGenEngine * clone() const = 0;
+
+// Restarts at the beginning of one of many independent streams of seed.
+	virtual void set_seed(uint32_t seed, uint64_t stream) = 0;
+
+// 64 uniformly distributed bits.
+	virtual uint64_t next() = 0;
+};
+
 /*===========================================================================*/
 // Random number generator.  True Gaussian pseudo-random variables.
 
@@ -22,6 +41,17 @@ class RGen :
 	typedef RGen self;
 
 public:
+/* MARSAGLIA is the 24-bit generator of earlier releases, XOSHIRO256SS and
+PHILOX4X32 give 53-bit doubles. */
+	enum Engine { MARSAGLIA, XOSHIRO256SS, PHILOX4X32 };
+
+/* BOX_MULLER gives the Gaussian sequence of earlier releases.  Values come in
+pairs and the second of a pair is kept across set_seed().  ZIGGURAT uses
+Doornik's ZIGNOR form of Marsaglia and Tsang's method, which rarely needs a
+transcendental function.  tgff draws no Gaussians, so this is for library
+users (e.g. MathVec::random_dir) and has no tgff option. */
+	enum Gauss { BOX_MULLER, ZIGGURAT };
+
 // Construction
 	virtual ~RGen();
 	explicit RGen(int seed = 1);
@@ -33,8 +63,23 @@ public:
 
 // Final
 	void set_seed(int seed = 1);
+
+// Seeds the Marsaglia table directly.  Other engines ignore this.
 	void set_seed(int i, int j, int k, int l);
 
+/* Seeds one of many independent streams derived from seed, e.g. one per
+task graph, so parallel work draws the same numbers in any schedule.  Stream
+-1 is reserved: with the 53-bit engines it would repeat set_seed(seed). */
+	void set_seed(int seed, long stream);
+
+// Switches engine and reseeds with seed 1.
+	void set_engine(Engine e);
+	Engine engine() const { return engine_type_; }
+
+// Switches Gaussian method (default BOX_MULLER) and drops any kept value.
+	void set_gauss(Gauss g);
+	Gauss gauss() const { return gauss_type_; }
+
 // [0, 1)
 	double flat01();
 
@@ -48,6 +93,12 @@ public:
 	double flat_range_d(double low, double high);
 	long flat_range_l(long low, long high);
 
+/* Fill all of out with the values the same number of calls to flat01() or
+flat_range_* would return, in order. */
+	void flat01_fill(RVector<double> & out);
+	void flat_range_d_fill(RVector<double> & out, double low, double high);
+	void flat_range_l_fill(RVector<long> & out, long low, long high);
+
 	double gauss_mean_d(double mean, double variance);
 	long gauss_mean_l(long mean, double variance);
 
@@ -55,22 +106,56 @@ public:
 	double gauss_mean_half_d(double mean, double variance);
 	long gauss_mean_half_l(long mean, double variance);
 
+/* Fill all of out with the values the same number of calls to gauss01() or
+gauss_mean_* would return, in order. */
+	void gauss_fill(RVector<double> & out);
+	void gauss_mean_d_fill(RVector<double> & out, double mean, double variance);
+	void gauss_mean_half_d_fill(RVector<double> & out, double mean,
+		double variance);
+
 // Returns 1 if a randomly generated number [0:1) is below the cut-off.
 	bool flip(double cut_off = 0.5);
 
-// Get access to a global generator which is allocated on first use.
+/* Get access to a global generator which is allocated on first use, or to the
+generator bound to the calling thread by an RGenBind. */
 	static RGen & gen();
 
 private:
+	void flat01_fill(double * out, long n);
+	double box_muller(double & second);
+	double ziggurat();
 	static void gen_test_data(std::ostream & os);
 
 		int ip_, jp_;
 		float c_, cd_, cm_;
 		HolderPtr<RVector<float> > u_;
+		Engine engine_type_;
+		HolderPtr<RGenEngine> engine_;
+		Gauss gauss_type_;
+		bool gauss_held_;
+		double gauss_next_;
 
+		static __thread RGen * bound_;
+
+	friend class RGenBind;
 	friend void RGen_test();
 };
 
+/*===========================================================================*/
+// Makes RGen::gen() return g in the calling thread while in scope.
+
+class RGenBind {
+public:
+	explicit RGenBind(RGen & g) : prev_(RGen::bound_) { RGen::bound_ = &g; }
+	~RGenBind() { RGen::bound_ = prev_; }
+
+private:
+	RGenBind(const RGenBind &);
+	RGenBind & operator=(const RGenBind &);
+
+		RGen * prev_;
+};
+
 void RGen_test();
 
 /*###########################################################################*/
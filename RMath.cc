@@ -302,8 +302,8 @@ MathVec::flat_mul(const value_type & a) {
 MathVec &
 MathVec::random_dir(value_type magnitude, RGen & rg) {
 	bool all_zero = true;
+	rg.gauss_fill(*this);
 	MAP(x, size()) {
-		(*this)[x] = rg.gauss_mean_d(0.0, 1.0);
 		if ((*this)[x])
 			all_zero = false;
 	}
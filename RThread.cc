@@ -0,0 +1,81 @@
+// Copyright 2008 by Robert Dick.
+// All rights reserved.
+
+#include "RThread.h"
+
+#include "RStd.h"
+#include "RVector.h"
+
+#include <pthread.h>
+
+namespace rstd {
+using namespace std;
+
+/*###########################################################################*/
+namespace {
+
+// State shared by the workers of one parallel_map call.
+struct ParallelJob {
+		ParallelBody * body;
+		long n;
+		long next;
+		pthread_mutex_t lock;
+};
+
+/*===========================================================================*/
+void * parallel_worker(void * arg) {
+	ParallelJob & job = *static_cast<ParallelJob *>(arg);
+
+	while (1) {
+		pthread_mutex_lock(&job.lock);
+		const long i = job.next++;
+		pthread_mutex_unlock(&job.lock);
+
+		if (i >= job.n)
+			break;
+
+		(*job.body)(i);
+	}
+
+	return 0;
+}
+
+}
+
+/*===========================================================================*/
+void parallel_map(long n, int threads, ParallelBody & body) {
+	if (threads < 2 || n < 2) {
+		MAP(x, n) {
+			body(x);
+		}
+
+		return;
+	}
+
+	ParallelJob job;
+	job.body = &body;
+	job.n = n;
+	job.next = 0;
+	pthread_mutex_init(&job.lock, 0);
+
+// The calling thread is one of the workers.
+	const long spawn = min(static_cast<long>(threads), n) - 1;
+	RVector<pthread_t> tid(spawn);
+
+	MAP(x, spawn) {
+		if (pthread_create(&tid[x], 0, parallel_worker, &job)) {
+			Rabort();
+		}
+	}
+
+	parallel_worker(&job);
+
+	MAP(x, spawn) {
+		pthread_join(tid[x], 0);
+	}
+
+	pthread_mutex_destroy(&job.lock);
+}
+
+/*###########################################################################*/
+}
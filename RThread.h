@@ -0,0 +1,34 @@
+// Copyright 2008 by Robert Dick.
+// All rights reserved.
+
+#ifndef R_THREAD_H_
+#define R_THREAD_H_
+
+// Runs independent loop iterations on a small pool of POSIX threads.
+
+/*###########################################################################*/
+namespace rstd {
+
+/*===========================================================================*/
+// One iteration of a parallel loop.
+
+class ParallelBody {
+public:
+	virtual ~ParallelBody() {}
+	virtual void operator()(long i) = 0;
+};
+
+/* Calls body(i) exactly once for every i in [0, n), using up to threads
+threads.  Iterations are handed out in increasing order but may finish in any
+order.  Runs in the calling thread if threads < 2 or n < 2. */
+
+void parallel_map(long n, int threads, ParallelBody & body);
+
+// Adapts any function object taking a long.
+template <typename FUNC>
+	void parallel_map(long n, int threads, FUNC func);
+
+/*###########################################################################*/
+#include "RThread.cct"
+}
+#endif
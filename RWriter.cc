@@ -0,0 +1,162 @@
+// Copyright 2008 by Robert Dick.
+// All rights reserved.
+
+#include "RWriter.h"
+
+#include "RStd.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace rstd {
+using namespace std;
+
+/*###########################################################################*/
+RWriter::RWriter(ostream & os, long capacity) :
+	os_(os),
+	buf_(capacity),
+	pos_(0),
+	width_(0),
+	left_(os.flags() & ios::left)
+{
+	RASSERT(capacity > 0);
+}
+
+/*===========================================================================*/
+RWriter::~RWriter() {
+	flush();
+}
+
+/*===========================================================================*/
+RWriter & RWriter::operator<<(const char * s) {
+	put(s, strlen(s));
+	return *this;
+}
+
+/*===========================================================================*/
+RWriter & RWriter::operator<<(const string & s) {
+	put(s.data(), s.size());
+	return *this;
+}
+
+/*===========================================================================*/
+RWriter & RWriter::operator<<(char c) {
+	put(&c, 1);
+	return *this;
+}
+
+/*===========================================================================*/
+RWriter & RWriter::operator<<(int i) {
+	return *this << static_cast<long>(i);
+}
+
+/*===========================================================================*/
+RWriter & RWriter::operator<<(long i) {
+	if (i < 0) {
+		put_integer(0UL - static_cast<unsigned long>(i), true);
+	} else {
+		put_integer(i, false);
+	}
+
+	return *this;
+}
+
+/*===========================================================================*/
+RWriter & RWriter::operator<<(unsigned i) {
+	put_integer(i, false);
+	return *this;
+}
+
+/*===========================================================================*/
+RWriter & RWriter::operator<<(unsigned long i) {
+	put_integer(i, false);
+	return *this;
+}
+
+/*===========================================================================*/
+RWriter & RWriter::operator<<(double d) {
+// %g prints whole numbers of up to six digits as plain integers.  Not -0.
+	if (d > -1e6 && d < 1e6 && d == static_cast<long>(d) &&
+		(d != 0.0 || 1.0 / d > 0.0))
+	{
+		return *this << static_cast<long>(d);
+	}
+
+// Default stream formatting is %g at precision 6.
+	char tmp[32];
+	const int n = sprintf(tmp, "%g", d);
+	RASSERT(n > 0 && n < static_cast<int>(sizeof(tmp)));
+	put(tmp, n);
+	return *this;
+}
+
+/*===========================================================================*/
+void RWriter::flush() {
+	if (pos_) {
+		os_.write(&buf_[0], pos_);
+		pos_ = 0;
+	}
+}
+
+/*===========================================================================*/
+void RWriter::put(const char * s, long n) {
+	const long pad = width_ > n ? width_ - n : 0;
+	width_ = 0;
+
+	if (pos_ + n + pad > static_cast<long>(buf_.size())) {
+		flush();
+
+// Too big to buffer at all.
+		if (n + pad > static_cast<long>(buf_.size())) {
+			if (! left_) {
+				os_ << string(pad, ' ');
+			}
+
+			os_.write(s, n);
+
+			if (left_) {
+				os_ << string(pad, ' ');
+			}
+
+			return;
+		}
+	}
+
+	char * out = &buf_[pos_];
+
+	if (! left_) {
+		memset(out, ' ', pad);
+		out += pad;
+	}
+
+	memcpy(out, s, n);
+	out += n;
+
+	if (left_) {
+		memset(out, ' ', pad);
+	}
+
+	pos_ += n + pad;
+}
+
+/*===========================================================================*/
+void RWriter::put_integer(unsigned long mag, bool neg) {
+	char tmp[24];
+	char * const end = tmp + sizeof(tmp);
+	char * p = end;
+
+	do {
+		*--p = static_cast<char>('0' + mag % 10);
+		mag /= 10;
+	} while (mag);
+
+	if (neg) {
+		*--p = '-';
+	}
+
+	put(p, end - p);
+}
+
+/*###########################################################################*/
+}
@@ -0,0 +1,57 @@
+// Copyright 2008 by Robert Dick.
+// All rights reserved.
+
+#ifndef R_WRITER_H_
+#define R_WRITER_H_
+
+/*###########################################################################*/
+#include "RVector.h"
+
+#include <iosfwd>
+#include <string>
+
+namespace rstd {
+/*===========================================================================*/
+/* Buffered text output for bulk data.  Items are formatted into a reusable
+buffer which is handed to the stream in large writes, bypassing the per-item
+cost of iostream formatting.  Numbers come out exactly as a stream with default
+settings would print them. */
+
+class RWriter {
+public:
+	explicit RWriter(std::ostream & os, long capacity = 1 << 16);
+	~RWriter();
+
+	RWriter & operator<<(const char * s);
+	RWriter & operator<<(const std::string & s);
+	RWriter & operator<<(char c);
+	RWriter & operator<<(int i);
+	RWriter & operator<<(long i);
+	RWriter & operator<<(unsigned i);
+	RWriter & operator<<(unsigned long i);
+	RWriter & operator<<(double d);
+
+/* Pads the next item to w characters, like std::setw().  Padding goes on the
+right if the stream had ios::left set when the writer was made. */
+	RWriter & setw(int w) { width_ = w; return *this; }
+
+// Hands everything buffered to the stream.
+	void flush();
+
+private:
+	RWriter(const RWriter &);
+	RWriter & operator=(const RWriter &);
+
+	void put(const char * s, long n);
+	void put_integer(unsigned long mag, bool neg);
+
+		std::ostream & os_;
+		RVector<char> buf_;
+		long pos_;
+		int width_;
+		bool left_;
+};
+
+/*###########################################################################*/
+}
+#endif
@@ -6,6 +6,7 @@
 #include <iomanip>
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 
 #include "RMath.h"
 #include "Epsilon.h"
@@ -13,10 +14,46 @@
 #include "RStd.h"
 #include "RGen.h"
 #include "ArgPack.h"
+#include "RWriter.h"
+#include "TGBWriter.h"
+#include "RCounter.h"
 
 using namespace std;
 using namespace rstd;
 
+namespace {
+	RCounter xarc_rejected_cnt("series_xarc_rejected");
+
+// Raw values for spill_to() and unspill().
+	template <typename T>
+	void put_raw(RVector<char> & buf, const T & v) {
+		const long at = buf.size();
+		buf.resize(at + sizeof(T));
+		memcpy(&buf[at], &v, sizeof(T));
+	}
+
+	template <typename T>
+	T get_raw(const char * & p) {
+		T v;
+		memcpy(&v, p, sizeof(T));
+		p += sizeof(T);
+		return v;
+	}
+
+	void put_longs(RVector<char> & buf, const RVector<long> & v) {
+		MAP(x, v.size()) {
+			put_raw(buf, v[x]);
+		}
+	}
+
+	void get_longs(const char * & p, RVector<long> & v, long n) {
+		v.resize(n);
+		MAP(x, n) {
+			v[x] = get_raw<long>(p);
+		}
+	}
+}
+
 /*###########################################################################*/
 TGnode::TGnode() :
 	type(-1),
@@ -46,17 +83,7 @@ TGnode::TGnode(int i) :
 	series_children_(),
 	series_parent_(-1)
 {
-	MAP(x, ArgPack::ap().task_attrib_av.size()) {
-		double val = ArgPack::ap().task_attrib_av[x] +
-		  RGen::gen().flat_range_d(-ArgPack::ap().task_attrib_mul[x],
-		  ArgPack::ap().task_attrib_mul[x]);
-
-		if (eps_not_equal_to<double>()(ArgPack::ap().task_attrib_round[x], 0.0)) {
-			val = interval_round(val, ArgPack::ap().task_attrib_round[x]);
-		}
-
-		attrib_.push_back(val);
-	}
+	gen_attrib();
 }
 
 /*===========================================================================*/
@@ -73,16 +100,99 @@ TGnode::TGnode(int i, int t, unsigned ri, unsigned ru) :
 	series_children_(),
 	series_parent_(-1)
 {
-	MAP(x, ArgPack::ap().task_attrib_av.size()) {
-		double val = ArgPack::ap().task_attrib_av[x] +
-		  RGen::gen().flat_range_d(-ArgPack::ap().task_attrib_mul[x],
-		  ArgPack::ap().task_attrib_mul[x]);
+	gen_attrib();
+}
 
-		if (eps_not_equal_to<double>()(ArgPack::ap().task_attrib_round[x], 0.0)) {
-			val = interval_round(val, ArgPack::ap().task_attrib_round[x]);
+/*===========================================================================*/
+void TGnode::gen_attrib() {
+// One draw per attribute, taken in bulk.
+	const ArgPack & ap = ArgPack::ap();
+	attrib_.resize(ap.task_attrib_av.size());
+	RGen::gen().flat01_fill(attrib_);
+
+	MAP(x, attrib_.size()) {
+		const double mul = ap.task_attrib_mul[x];
+		attrib_[x] = ap.task_attrib_av[x] + ((mul + mul) * attrib_[x] - mul);
+
+		if (eps_not_equal_to<double>()(ap.task_attrib_round[x], 0.0)) {
+			attrib_[x] = interval_round(attrib_[x], ap.task_attrib_round[x]);
 		}
+	}
+}
 
-		attrib_.push_back(val);
+/*###########################################################################*/
+void FanoutIndex::clear(int out_deg) {
+	out_deg_ = out_deg;
+	top_ = 0;
+	bucket_.assign(out_deg > 0 ? out_deg + 1 : 1, RVector<long>());
+	pos_.clear();
+	room_.clear();
+	open_.clear();
+	open_pos_.clear();
+}
+
+/*===========================================================================*/
+void FanoutIndex::add_vertex() {
+	const long v = room_.size();
+	room_.push_back(max(out_deg_, 0));
+	pos_.push_back(-1);
+	open_pos_.push_back(-1);
+
+	if (out_deg_ > 0) {
+		pos_[v] = bucket_[out_deg_].size();
+		bucket_[out_deg_].push_back(v);
+		top_ = out_deg_;
+
+		open_pos_[v] = open_.size();
+		open_.push_back(v);
+	}
+}
+
+/*===========================================================================*/
+void FanoutIndex::add_arc(long v) {
+	int & room = room_[v];
+	if (room <= 0) {
+		--room;
+		return;
+	}
+
+// Swap v out of its bucket.
+	RVector<long> & from = bucket_[room];
+	const long last = from.back();
+	from[pos_[v]] = last;
+	pos_[last] = pos_[v];
+	from.pop_back();
+
+	if (--room > 0) {
+		pos_[v] = bucket_[room].size();
+		bucket_[room].push_back(v);
+	} else {
+		pos_[v] = -1;
+
+		const long open_last = open_.back();
+		open_[open_pos_[v]] = open_last;
+		open_pos_[open_last] = open_pos_[v];
+		open_.pop_back();
+		open_pos_[v] = -1;
+	}
+
+	while (top_ > 0 && bucket_[top_].empty()) {
+		--top_;
+	}
+}
+
+/*===========================================================================*/
+void FanoutIndex::sample_open(long k, RGen & gen, RVector<long> & out) {
+	RASSERT(k <= open_.size());
+	out.clear();
+
+// Partial Fisher-Yates shuffle of the front of open_.
+	MAP(x, k) {
+		const long y = gen.flat_range_l(x, open_.size());
+		swap(open_[x], open_[y]);
+		open_pos_[open_[x]] = x;
+		open_pos_[open_[y]] = y;
+		out.push_back(open_[x]);
 	}
 }
 
@@ -147,10 +257,19 @@ int first_task) {
 			series_parallel_generate_xover(local_xover, global_xover);
 		}
 	} else {
+	  FanoutIndex fanout;
+	  fanout.clear(out_deg_);
+	  while (fanout.size() < size_vertex()) {
+		 fanout.add_vertex();
+	  }
+
 	  while (size_vertex() < low_bound_) {
-		 augment();
+		 augment(fanout);
 	  }
 	}
+
+	freeze();
+	RDEBUG(self_check_deep());
 	compute_dims();
 
 	deadlines();
@@ -183,7 +302,13 @@ void TG::generate_series_parallel()
 	{
 		if (vertex(source)->size_out()) {
 			sync = edge(vertex(source)->out(0))->to();
-			erase_edge(vertex(source)->out(0));
+
+// Earlier releases kept the remaining arcs in order.
+			if (ArgPack::ap().gen_compat) {
+				erase_edge_ordered(vertex(source)->out(0));
+			} else {
+				erase_edge(vertex(source)->out(0));
+			}
 		} else {
 			sync = add_vertex(TGnode(size_vertex()));
 		}
@@ -210,6 +335,7 @@ void TG::generate_series_parallel()
 /*===========================================================================*/
 void TG::series_parallel_generate_xover(int local_xover, int global_xover)
 {
+	TopOrder order(*this);
 	RVector<long> tmp = series_parallel_get_all_parents();
 	while (local_xover > 0) {
 		random_shuffle(tmp.begin(), tmp.end(), RGen::gen());
@@ -232,7 +358,7 @@ void TG::series_parallel_generate_xover(int local_xover, int global_xover)
 			RVector<long>::iterator i = tmp2.begin(), j = tmp2.begin();
 			++j;
 			while(!done) {
-				if (series_parallel_xarc_added (*i, *j)) {
+				if (series_parallel_xarc_added (*i, *j, order)) {
 					done = true;
 				} else {
 					j++;
@@ -262,7 +388,7 @@ void TG::series_parallel_generate_xover(int local_xover, int global_xover)
 		RVector<long>::iterator i = tmp.begin(), j = tmp.begin();
 		++j;
 		while(!done) {
-			if (series_parallel_xarc_added (*i, *j)) {
+			if (series_parallel_xarc_added (*i, *j, order)) {
 				done = true;
 			} else {
 				j++;
@@ -291,57 +417,65 @@ RVector<long> TG::series_parallel_get_all_parents ()
 	return tmp;
 }
 
-bool TG::series_parallel_xarc_added (long a, long b)
+bool TG::series_parallel_xarc_added (long a, long b, TopOrder & order)
 {
 	if (nodes_linked (a, b)) {
+		xarc_rejected_cnt.add();
 		return false;		
 	}
 
-	add_edge (a, b, TGarc(size_edge()));
-
-	if (cyclic()) {
-		long t = vertex(a)->size_out();
-		erase_edge(vertex(a)->out(t - 1));
+// Reject arcs which would close a cycle before adding them.
+	if (! order.add_edge(a, b)) {
+		xarc_rejected_cnt.add();
 		return false;
 	}
 
+	add_edge (a, b, TGarc(size_edge()));
 	return true;
 }
 
 /*===========================================================================*/
-void TG::augment() {
+void TG::augment(FanoutIndex & fanout) {
 // SELECT TEMPLATE (either IN or OUT now)
 
 	if (RGen::gen().flip()) {
 // Pick FAN-OUT
-		RVector<long>	nodes_with_most_fanout;
-		int			max_fanout_found = 0;
-
-		MAP(x, size_vertex()) {
-			long node_fanout_avail = out_deg_ - 
-											static_cast<long>(vertex(x)->size_out());
-
-			if( node_fanout_avail <= 0 ) continue;
-			if( node_fanout_avail > max_fanout_found ) {
-				max_fanout_found = node_fanout_avail;
-				nodes_with_most_fanout.clear();
-				nodes_with_most_fanout.insert(nodes_with_most_fanout.begin(),x);
-//				nodes_with_most_fanout.push_back(x);
+		long selected_node = -1;
+
+		if (ArgPack::ap().gen_compat) {
+// Scan for the nodes with the most room.  Selection runs from the highest
+// index down, as in earlier releases.
+			RVector<long>	nodes_with_most_fanout;
+			int			max_fanout_found = 0;
+
+			MAP(x, size_vertex()) {
+				long node_fanout_avail = out_deg_ - 
+												static_cast<long>(vertex(x)->size_out());
+
+				if( node_fanout_avail <= 0 ) continue;
+				if( node_fanout_avail > max_fanout_found ) {
+					max_fanout_found = node_fanout_avail;
+					nodes_with_most_fanout.clear();
+					nodes_with_most_fanout.push_back(x);
+				}
+				else if( node_fanout_avail == max_fanout_found ) {
+					nodes_with_most_fanout.push_back(x);
+				}
 			}
-			else if( node_fanout_avail == max_fanout_found ) {
-				nodes_with_most_fanout.insert(nodes_with_most_fanout.begin(),x);
-//				nodes_with_most_fanout.push_back(x);
+
+			int nnodes = nodes_with_most_fanout.size();
+			if( nnodes > 0 ) {
+				// at least one has fanout room, and the list is those with
+				// the most room, randomly select one
+				int m = RGen::gen().flat_range_l(0, nnodes);
+				selected_node = nodes_with_most_fanout[nnodes - 1 - m];
 			}
+		} else if (fanout.most_size()) {
+			selected_node =
+				fanout.most(RGen::gen().flat_range_l(0, fanout.most_size()));
 		}
 
-		int nnodes = nodes_with_most_fanout.size();
-		if( nnodes > 0 ) {
-			// at least one has fanout room, and the list is those with
-			// the most room, randomly select one
-			int m = RGen::gen().flat_range_l(0, nnodes);
-
-			// pick node
-			long selected_node = nodes_with_most_fanout[m];
+		if (selected_node != -1) {
 			int node_fanout_avail = out_deg_ - 
 					static_cast<long>(vertex(selected_node)->size_out());
 
@@ -351,8 +485,10 @@ void TG::augment() {
 			// add in the new nodes and arcs
 			for (int x=0; x < n; x++) {
 				add_vertex(TGnode(size_vertex()));
+				fanout.add_vertex();
 				add_edge(selected_node, 
 							static_cast<long>(size_vertex())-1, TGarc(size_edge()));
+				fanout.add_arc(selected_node);
 			}
 		}
 	}
@@ -361,9 +497,13 @@ void TG::augment() {
 		// find out how many existing nodes are not over their
 		// OUTDEG limit...
 		int	nf = 0;
-		MAP (x, size_vertex()) {
-			if (vertex(x)->size_out() < out_deg_)
-				nf++;
+		if (ArgPack::ap().gen_compat) {
+			MAP (x, size_vertex()) {
+				if (vertex(x)->size_out() < out_deg_)
+					nf++;
+			}
+		} else {
+			nf = fanout.open_size();
 		}
 
 // at least one
@@ -372,13 +512,31 @@ void TG::augment() {
 		// determine # in deg
 		int o = min(static_cast<int>(size_vertex()), min(in_deg_, nf));
 		int n = RGen::gen().flat_range_l(1, o + 1);
-		RGen::gen().flat_range_l(1, o + 1);
+
+		if (ArgPack::ap().gen_compat) {
+			RGen::gen().flat_range_l(1, o + 1);
+		}
 
 		// create new node
 		add_vertex(TGnode(size_vertex()));
+		vertex_index node = static_cast<long>(size_vertex()) - 1;
+
+		if (! ArgPack::ap().gen_compat) {
+// Draw distinct parents among the nodes with room before indexing the new one.
+			RVector<long> parents;
+			fanout.sample_open(n, RGen::gen(), parents);
+			fanout.add_vertex();
+
+			MAP(x, parents.size()) {
+				add_edge(parents[x], node, TGarc(size_edge()));
+				fanout.add_arc(parents[x]);
+			}
+			return;
+		}
+
+		fanout.add_vertex();
 
 		// find places to attach, ensure no dupl arcs
-		vertex_index node = static_cast<long>(size_vertex()) - 1;
 		MAP (x, size_vertex()) {
 			(*this)[x].h = (x == node ? 1 : 0);
 		}
@@ -402,60 +560,71 @@ void TG::augment() {
 				continue;
 
 			add_edge(trynode, node, TGarc(size_edge())); 
+			fanout.add_arc(trynode);
 			c++;
 		}
 	}
 }
 
+/*===========================================================================*/
+void TG::self_check_deep() const {
+	Graph<TGnode, TGarc>::self_check_deep();
+
+	RVector<vertex_index> cycle;
+	if (find_cycle(cycle)) {
+		cerr << "TG: graph " << number_ << " has a cycle:";
+		MAP(x, cycle.size()) {
+			cerr << " " << cycle[x] << " ->";
+		}
+		cerr << " " << cycle[0] << "\n";
+		Rabort();
+	}
+}
+
 /*===========================================================================*/
 void TG::print_to(ostream & os) const {
+	RWriter out(os);
+	print_to(out);
+}
+
+/*===========================================================================*/
+void TG::print_to(RWriter & out) const {
 	if (period_ > 0.0) {
-		os << "\tPERIOD " << period_ << "\n\n";
+		out << "\tPERIOD " << period_ << "\n\n";
 	} else {
 	    if (ArgPack::ap().aperiodic_min_used) {
-		os << "\tAPERIODIC " << aperiod_ << "\n\n";
+		out << "\tAPERIODIC " << aperiod_ << "\n\n";
 	    } else {
-		os << "\tAPERIODIC\n\n";
+		out << "\tAPERIODIC\n\n";
 	    }
 	}
 
-	int indx = first_task_;
-	MAP (x, size_vertex()) {
-		os << "\tTASK t" << number_ << "_" << (*this)[x].name << "\tTYPE ";
+	RVector<long> task_type, arc_type;
+	resolve_types(task_type, arc_type);
 
-		if ((*this)[x].type != -1) {
-			os << (*this)[x].type << " ";
-		} else if (ArgPack::ap().task_unique) {
-			os << indx++ << " ";
-		} else {
-			os << RGen::gen().flat_range_l(0, ArgPack::ap().task_type_cnt) << " ";
-		}
+	MAP (x, size_vertex()) {
+		out << "\tTASK t" << number_ << "_" << (*this)[x].name << "\tTYPE ";
+		out << task_type[x] << " ";
 
 		MAP(y, ArgPack::ap().task_attrib_name.size()) {
-			os << ArgPack::ap().task_attrib_name[y] << " " 
+			out << ArgPack::ap().task_attrib_name[y] << " " 
 				<< (*this)[x].attrib_[y] << " ";
 		}
-		os << "\n";
+		out << "\n";
 	}
 
-	os << "\n";
+	out << "\n";
 
 	MAP (x, size_edge()) {
-		os << "\tARC "
+		out << "\tARC "
 			<< "a" << number_ << "_" << (*this)(x).name << " \tFROM "
 			<< "t" << number_ << "_" << edge(x)->from() << "  TO  "
 			<< "t" << number_ << "_" << edge(x)->to();
 
-		int task_type;
-		if( (*this)(x).type < 0 )
-			task_type = RGen::gen().flat_range_l(0, ArgPack::ap().trans_type_cnt);
-		else
-			task_type = (*this)(x).type;
-
-		os << " TYPE " << task_type << endl;
+		out << " TYPE " << arc_type[x] << '\n';
 	}
 
-	os << "\n";
+	out << "\n";
 
 // Deadlines
 // SIMPLE FOR NOW: PUT DEADLINE ON ALL "TERMINAL PROCESSES"
@@ -463,67 +632,241 @@ void TG::print_to(ostream & os) const {
 	MAP (x, size_vertex()) {
 		if((*this)[x].deadline > 0) {
 			if ((*this)[x].hard) {
-				os	<< "\tHARD_DEADLINE " <<
+				out	<< "\tHARD_DEADLINE " <<
 				  "d" << number_ << "_" << dcount++ <<
 				  " ON " << "t" << number_ << 
 					"_" <<(*this)[x].name << " AT " <<
 				  (*this)[x].deadline << "\n";
 			} else {
-				os	<< "\tSOFT_DEADLINE " <<
+				out	<< "\tSOFT_DEADLINE " <<
 				  "d" << number_ << "_" << dcount++ <<
 				  " ON " << "t_" << (*this)[x].name << " AT " <<
 				  (*this)[x].deadline * ArgPack::ap().soft_deadline_mul << "\n";
 			}
 		}
 	}
-	os << "}\n\n\n";
+	out << "}\n\n\n";
 }
 
 /*===========================================================================*/
-void TG::push_period() {
-// Find the max deadline.
-	double max_d = 0.0;
+void TG::print_to_tgb(TGBWriter & out, long number) const {
+	RVector<long> task_type, arc_type;
+	resolve_types(task_type, arc_type);
 
-	MAP (x, size_vertex()) {
-		max_d = max(max_d, (*this)[x].deadline);
+	const RVector<string> & attrib_name = ArgPack::ap().task_attrib_name;
+
+	out.begin_graph();
+	out.put_i64(number);
+	out.put_i64(size_vertex());
+	out.put_i64(size_edge());
+	out.put_i64(attrib_name.size());
+
+	out.put_f64(period_ > 0.0 ? period_ : -1.0);
+	out.put_i64(period_ <= 0.0 && ArgPack::ap().aperiodic_min_used ?
+		aperiod_ : -1);
+
+	out.put_string(ArgPack::ap().tg_label);
+	MAP(y, attrib_name.size()) {
+		out.put_string(attrib_name[y]);
+	}
+	out.align();
+
+	MAP(x, size_vertex()) {
+		out.put_i64((*this)[x].name);
+	}
+
+	MAP(x, size_vertex()) {
+		out.put_i64(task_type[x]);
+	}
+
+	MAP2(x, size_vertex(), y, attrib_name.size()) {
+		out.put_f64((*this)[x].attrib_[y]);
+	}
+
+	MAP(x, size_vertex()) {
+		const TGnode & n = (*this)[x];
+		out.put_f64(n.deadline > 0 && ! n.hard ?
+			n.deadline * ArgPack::ap().soft_deadline_mul : n.deadline);
+	}
+
+	MAP(x, size_vertex()) {
+		out.put_u8((*this)[x].hard);
 	}
-	period_ = max(period_, max_d);
+	out.align();
+
+// The arcs go out in the frozen view's layout.
+	frozen_type scratch;
+	if (! frozen()) {
+		freeze_to(scratch);
+	}
+
+	const frozen_type & csr = frozen() ? frozen_view() : scratch;
+
+	MAP(x, csr.out_begin.size()) {
+		out.put_i64(csr.out_begin[x]);
+	}
+
+	MAP(x, csr.out_vertex.size()) {
+		out.put_i64(csr.out_vertex[x]);
+	}
+
+	MAP(x, csr.out_edge.size()) {
+		out.put_i64((*this)(csr.out_edge[x]).name);
+	}
+
+	MAP(x, csr.out_edge.size()) {
+		out.put_i64(arc_type[csr.out_edge[x]]);
+	}
+
+	out.end_graph();
 }
 
 /*===========================================================================*/
-void TG::compute_dims() {
-    // find out how tall and wide the dag is ...
-    // Get node depths, DUMB method [O(n^2) I think]
- 
+void TG::spill_to(RVector<char> & buf) const {
+	RASSERT(frozen());
+
+	put_raw(buf, static_cast<long>(size_vertex()));
+	put_raw(buf, static_cast<long>(size_edge()));
+	put_raw(buf, maxw);
+	put_raw(buf, maxh);
+	put_raw(buf, in_deg_);
+	put_raw(buf, out_deg_);
+	put_raw(buf, number_);
+
 	MAP(x, size_vertex()) {
-		(*this)[x].h = (*this)[x].w = -1;
+		const TGnode & n = (*this)[x];
+		put_raw(buf, n.type);
+		put_raw(buf, n.ri_);
+		put_raw(buf, n.ru_);
+		put_raw(buf, n.name);
+		put_raw(buf, n.deadline);
+		put_raw(buf, static_cast<char>(n.hard));
+		put_raw(buf, n.h);
+		put_raw(buf, n.w);
+		put_raw(buf, static_cast<long>(n.attrib_.size()));
+
+		MAP(y, n.attrib_.size()) {
+			put_raw(buf, n.attrib_[y]);
+		}
 	}
-	int mh = 0;
-	int change;
-	do {
-		change = 0;
-		MAP(x, size_vertex()) {
-			int pl = parents_h(x);
-			if( pl+1 > ((*this)[x].h)) {
-				(*this)[x].h = pl+1;
-				mh = max(mh, (*this)[x].h);
-				change = 1;
-			}
+
+	MAP(x, size_edge()) {
+		put_raw(buf, static_cast<long>(edge(x)->from()));
+		put_raw(buf, static_cast<long>(edge(x)->to()));
+		put_raw(buf, (*this)(x).name);
+		put_raw(buf, (*this)(x).type);
+	}
+
+	const frozen_type & csr = frozen_view();
+	put_longs(buf, csr.out_begin);
+	put_longs(buf, csr.out_edge);
+	put_longs(buf, csr.in_begin);
+	put_longs(buf, csr.in_edge);
+}
+
+/*===========================================================================*/
+void TG::unspill(const char * p) {
+	RASSERT(! size_vertex());
+
+	const long v_cnt = get_raw<long>(p);
+	const long e_cnt = get_raw<long>(p);
+	maxw = get_raw<int>(p);
+	maxh = get_raw<int>(p);
+	in_deg_ = get_raw<int>(p);
+	out_deg_ = get_raw<int>(p);
+	number_ = get_raw<int>(p);
+
+	MAP(x, v_cnt) {
+		TGnode n;
+		n.type = get_raw<int>(p);
+		n.ri_ = get_raw<unsigned>(p);
+		n.ru_ = get_raw<unsigned>(p);
+		n.name = get_raw<int>(p);
+		n.deadline = get_raw<double>(p);
+		n.hard = get_raw<char>(p);
+		n.h = get_raw<int>(p);
+		n.w = get_raw<int>(p);
+
+		n.attrib_.resize(get_raw<long>(p));
+		MAP(y, n.attrib_.size()) {
+			n.attrib_[y] = get_raw<double>(p);
+		}
+
+		add_vertex(n);
+	}
+
+	MAP(x, e_cnt) {
+		const long from = get_raw<long>(p);
+		const long to = get_raw<long>(p);
+
+		TGarc arc;
+		arc.name = get_raw<int>(p);
+		arc.type = get_raw<int>(p);
+		add_edge(from, to, arc);
+	}
+
+	frozen_type csr;
+	get_longs(p, csr.out_begin, v_cnt + 1);
+	get_longs(p, csr.out_edge, e_cnt);
+	get_longs(p, csr.in_begin, v_cnt + 1);
+	get_longs(p, csr.in_edge, e_cnt);
+
+	order_edges(csr);
+	freeze();
+}
+
+/*===========================================================================*/
+void TG::resolve_types(RVector<long> & task_type, RVector<long> & arc_type)
+const {
+	task_type.resize(size_vertex());
+	arc_type.resize(size_edge());
+
+	int indx = first_task_;
+	MAP(x, size_vertex()) {
+		if ((*this)[x].type != -1) {
+			task_type[x] = (*this)[x].type;
+		} else if (ArgPack::ap().task_unique) {
+			task_type[x] = indx++;
+		} else {
+			task_type[x] =
+				RGen::gen().flat_range_l(0, ArgPack::ap().task_type_cnt);
 		}
-	} while(change);
-	maxh = ++mh;   // mh is height
+	}
 
-	// heights assigned, next widths
-	RVector<int> wlist;
-	MAP (x, mh) {
-		wlist.push_back(0);
+	MAP(x, size_edge()) {
+		if ((*this)(x).type < 0) {
+			arc_type[x] =
+				RGen::gen().flat_range_l(0, ArgPack::ap().trans_type_cnt);
+		} else {
+			arc_type[x] = (*this)(x).type;
+		}
 	}
-	int mw = 0;
+}
+
+/*===========================================================================*/
+double TG::max_deadline() const {
+	double max_d = 0.0;
+
+	MAP (x, size_vertex()) {
+		max_d = max(max_d, (*this)[x].deadline);
+	}
+	return max_d;
+}
+
+/*===========================================================================*/
+void TG::compute_dims() {
+// Node heights and widths, used for deadlines and drawing.
+	levels_type lv;
+	levelize(lv);
+
 	MAP(x, size_vertex()) {
-		(*this)[x].w = wlist[(*this)[x].h]++;
-		mw = max(mw, (*this)[x].w);
+		(*this)[x].h = lv.depth[x];
+		(*this)[x].w = lv.rank[x];
 	}
-	maxw = ++mw;
+
+// An empty graph still occupies one cell.
+	maxh = max(lv.height, 1);
+	maxw = max(lv.width, 1);
 }
 
 /*===========================================================================*/
@@ -546,47 +889,43 @@ void TG::deadlines() {
 }
 
 /*===========================================================================*/
-int TG::parents_h(long n) {
-	int rv = -1;
-	MAP (x, vertex(n)->size_in()) {
-		edge_index e(vertex(n)->in(x));
-		rv = max(rv, (*this)[edge(e)->from()].h);
-	}
-	return rv;
+void TG::print_to_vcg(ostream & os) const {
+	RWriter out(os);
+	print_to_vcg(out);
 }
 
 /*===========================================================================*/
-void TG::print_to_vcg(ostream & os) const {
+void TG::print_to_vcg(RWriter & out) const {
 	int indx = first_task_;
 	MAP(x, size_vertex()) {
-		os << "\tnode: { title: \"" << "t" << number_ << "_" << (*this)[x].name
+		out << "\tnode: { title: \"" << "t" << number_ << "_" << (*this)[x].name
 			<< "\" label: \"" << "t" << number_ << "_" << (*this)[x].name;
 		if ((*this)[x].type != -1) {
-			os << (*this)[x].type << "\" ";
+			out << (*this)[x].type << "\" ";
 		} else if (ArgPack::ap().task_unique) {
-			os << " (" << indx++ << ")\" ";
+			out << " (" << indx++ << ")\" ";
 		} else {
-			os << " (" 
+			out << " (" 
 				<< RGen::gen().flat_range_l(0, ArgPack::ap().task_type_cnt)
 				<< ")\" ";
 		}
 
 		if (vertex(x)->size_in()) {
 			if (vertex(x)->size_out()) {
-				os << " color: white ";
+				out << " color: white ";
 			} else {
-				os << " color: lightred ";
+				out << " color: lightred ";
 			}
 		} else {
-			os << " color: lightgreen ";
+			out << " color: lightgreen ";
 		}
-		os << "} \n";
+		out << "} \n";
 	}
 
-	os << "\n";
+	out << "\n";
 
 	MAP(x, size_edge()) {
-		os << "\tedge: { thickness: 2 sourcename:\""
+		out << "\tedge: { thickness: 2 sourcename:\""
 			<< "t" << number_ << "_" << (*this)[edge(x)->from()].name
 			<< "\" targetname: \""
 			<< "t" << number_ << "_" << (*this)[edge(x)->to()].name << "\" ";
@@ -597,8 +936,8 @@ void TG::print_to_vcg(ostream & os) const {
 		else
 			task_type = (*this)(x).type;
 
-		os << " label: \"(" << task_type << ")\" } \n" << endl;
+		out << " label: \"(" << task_type << ")\" } \n" << '\n';
 	}
-	os << "\n";
+	out << "\n";
 }
 
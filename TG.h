@@ -11,6 +11,9 @@
 
 #include <iosfwd>
 
+namespace rstd { class RGen; class RWriter; }
+class TGBWriter;
+
 /*###########################################################################*/
 class TGnode {
 public:
@@ -27,6 +30,9 @@ public:
 	rstd::RVector<double> attrib_;
 	rstd::RVector<long> series_children_;
 	long series_parent_;
+
+private:
+	void gen_attrib();
 };
 
 /*===========================================================================*/
@@ -40,6 +46,45 @@ public:
 	TGarc(int n, unsigned t) : name(n), type(t)	{};	// {name = n; type = t;};
 };
 
+/*===========================================================================*/
+/* Vertices bucketed by remaining fan-out (out_deg - out arcs).  Kept current
+as vertices and arcs are added, so a vertex with the most room can be picked
+in constant time, and k distinct vertices with any room in O(k). */
+
+class FanoutIndex {
+public:
+	FanoutIndex() : out_deg_(0), top_(0), bucket_(), pos_(), room_(),
+		open_(), open_pos_() {}
+	void clear(int out_deg);
+
+// Indexes vertex number size(), which has no out arcs yet.
+	void add_vertex();
+// Records one more out arc on v.
+	void add_arc(long v);
+
+	long size() const { return room_.size(); }
+	int room(long v) const { return room_[v]; }
+
+// Vertices with the most room, in no particular order.
+	long most_size() const { return top_ > 0 ? bucket_[top_].size() : 0; }
+	long most(long i) const { return bucket_[top_][i]; }
+
+// Vertices with any room.
+	long open_size() const { return open_.size(); }
+
+// Puts k distinct vertices with room, drawn uniformly, into out.
+	void sample_open(long k, rstd::RGen & gen, rstd::RVector<long> & out);
+
+private:
+		int out_deg_;
+		int top_;
+		rstd::RVector<rstd::RVector<long> > bucket_;
+		rstd::RVector<long> pos_;
+		rstd::RVector<int> room_;
+		rstd::RVector<long> open_;
+		rstd::RVector<long> open_pos_;
+};
+
 /*===========================================================================*/
 class TG : public rstd::Graph<TGnode,TGarc> {
 public:
@@ -52,18 +97,48 @@ public:
 
 	void init(int number, int in_deg_req, int out_deg_req, double period_req);
 
+/* Aborts, listing the tasks on it, if the graph has a cycle.  O(v + e), so
+run once generation is done rather than on each change. */
+	virtual void self_check_deep() const;
+
 	void print_to(std::ostream & os) const;
+	void print_to(rstd::RWriter & out) const;
 	void print_to_vcg(std::ostream & os) const;
+	void print_to_vcg(rstd::RWriter & out) const;
+
+/* Writes one .tgffb graph block (see TGBWriter.h) labelled number.  Draws
+types in the same order as print_to(), so the content matches for a given seed.
+
+	u64		block size in bytes
+	i64		number, task count T, arc count A, attribute count N
+	f64		period, or -1 if aperiodic
+	i64		aperiod, or -1 if none is printed
+	string	label, then N attribute names (u32 length + bytes), padded to 8
+	i64		task name[T], task type[T]
+	f64		attribute[T * N], by task
+	f64		deadline[T], with soft deadlines scaled; only values > 0 are deadlines
+	u8		hard[T], padded to 8
+	i64		arc offset[T + 1], arc target[A], arc name[A], arc type[A]
+		(arcs in CSR form by source task, in out-arc order) */
+	void print_to_tgb(TGBWriter & out, long number) const;
+
+/* Appends the graph, as init() leaves it, to buf in native byte order, and
+rebuilds it from there into an empty TG.  Types stay unresolved and each
+vertex keeps its edge order, so the copy prints exactly as the original. */
+	void spill_to(rstd::RVector<char> & buf) const;
+	void unspill(const char * p);
 
 	friend void	i_PS_dag (std::ostream&, rstd::RVector<TG> &dag, int);
 
-	void push_period();
+	double max_deadline() const;
 	double period() const {return period_;}
 	long aperiod() const {return aperiod_;}
 	int in_deg() const {return in_deg_;}
 	int out_deg() const {return out_deg_;}
 	void set_period(double p) {period_ = p;}
 	void set_aperiod(long ap) {aperiod_ = ap;}
+	int first_task() const {return first_task_;}
+	void set_first_task(int first_task) {first_task_ = first_task;}
 
 	int max_w() const {return maxw;}
 	int max_h() const {return maxh;}
@@ -71,17 +146,20 @@ public:
 	void compute_dims();
 
 private:
-	void augment();
+	void augment(FanoutIndex & fanout);
 	void add_start_nodes();
 
 	void generate_series_parallel();
 	void series_parallel_generate_xover(int local_xover, int global_xover);
 	rstd::RVector<long> series_parallel_get_all_parents ();
-	bool series_parallel_xarc_added (long a, long b);
+	bool series_parallel_xarc_added (long a, long b, rstd::TopOrder & order);
 
 
 	void deadlines();
-	int parents_h(long n);
+
+// Task and arc types as printed, drawing the random ones.
+	void resolve_types(rstd::RVector<long> & task_type,
+		rstd::RVector<long> & arc_type) const;
 
 // dag max width and height
 		int maxw;
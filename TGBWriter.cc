@@ -0,0 +1,178 @@
+// Copyright 2008 by Robert Dick, David Rhodes, and Keith Vallerio.
+// All rights reserved.
+
+#include "TGBWriter.h"
+
+#include "RStd.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+using namespace rstd;
+
+/*###########################################################################*/
+namespace {
+
+const unsigned long HEADER_SIZE = 48;
+
+// Appends the low n bytes of v, least significant first, sign-extending.
+void put_le(RVector<char> & buf, long v, int n) {
+	MAP(x, n) {
+		if (x < static_cast<int>(sizeof(long))) {
+			buf.push_back(static_cast<char>((v >> (8 * x)) & 0xff));
+		} else {
+			buf.push_back(static_cast<char>(v < 0 ? 0xff : 0));
+		}
+	}
+}
+
+void put_le_unsigned(RVector<char> & buf, unsigned long v, int n) {
+	MAP(x, n) {
+		if (x < static_cast<int>(sizeof(unsigned long))) {
+			buf.push_back(static_cast<char>((v >> (8 * x)) & 0xff));
+		} else {
+			buf.push_back(0);
+		}
+	}
+}
+
+bool host_little_endian() {
+	const unsigned short one = 1;
+	return *reinterpret_cast<const unsigned char *>(&one) == 1;
+}
+
+void put_le_double(RVector<char> & buf, double v) {
+	RASSERT(sizeof(double) == 8);
+	char bytes[8];
+	memcpy(bytes, &v, 8);
+
+	MAP(x, 8) {
+		buf.push_back(bytes[host_little_endian() ? x : 7 - x]);
+	}
+}
+
+}
+
+/*###########################################################################*/
+TGBWriter::TGBWriter() :
+	os_(),
+	block_(),
+	dir_(),
+	offset_(0)
+{}
+
+/*===========================================================================*/
+void TGBWriter::open(const string & file_name) {
+	RASSERT(! is_open());
+
+	os_.open(file_name.c_str(), ios::out | ios::binary | ios::trunc);
+	if (! os_) {
+		cout << "Unable to open TGFF binary output file.\n";
+		exit(EXIT_FAILURE);
+	}
+
+	dir_.clear();
+	write_header(0, 0, -1.0);
+	offset_ = HEADER_SIZE;
+}
+
+/*===========================================================================*/
+void TGBWriter::close(double h_period) {
+	RASSERT(is_open());
+	RASSERT(block_.empty());
+
+	const unsigned long dir_offset = offset_;
+	MAP(x, dir_.size()) {
+		put_le_unsigned(block_, dir_[x], 8);
+	}
+	write_block();
+
+	os_.seekp(0);
+	write_header(dir_.size(), dir_offset, h_period);
+	os_.close();
+}
+
+/*===========================================================================*/
+void TGBWriter::begin_graph() {
+	RASSERT(is_open());
+	RASSERT(block_.empty());
+
+// Block size, filled in by end_graph().
+	put_le_unsigned(block_, 0, 8);
+}
+
+/*===========================================================================*/
+void TGBWriter::end_graph() {
+	align();
+
+	RVector<char> size;
+	put_le_unsigned(size, block_.size(), 8);
+	copy(size.begin(), size.end(), block_.begin());
+
+	dir_.push_back(offset_);
+	write_block();
+}
+
+/*===========================================================================*/
+void TGBWriter::put_u8(unsigned v) {
+	put_le_unsigned(block_, v, 1);
+}
+
+/*===========================================================================*/
+void TGBWriter::put_u32(unsigned long v) {
+	put_le_unsigned(block_, v, 4);
+}
+
+/*===========================================================================*/
+void TGBWriter::put_i64(long v) {
+	put_le(block_, v, 8);
+}
+
+/*===========================================================================*/
+void TGBWriter::put_f64(double v) {
+	put_le_double(block_, v);
+}
+
+/*===========================================================================*/
+void TGBWriter::put_string(const string & s) {
+	put_u32(s.size());
+	block_.insert(block_.end(), s.begin(), s.end());
+}
+
+/*===========================================================================*/
+void TGBWriter::align() {
+	while (block_.size() % 8) {
+		block_.push_back(0);
+	}
+}
+
+/*===========================================================================*/
+void TGBWriter::write_header(unsigned long graph_cnt,
+unsigned long dir_offset, double h_period)
+{
+	RVector<char> header;
+	const char magic[8] = { 'T', 'G', 'F', 'F', 'B', 'I', 'N', '\0' };
+	header.insert(header.end(), magic, magic + 8);
+
+	put_le_unsigned(header, TGB_VERSION, 4);
+	put_le_unsigned(header, HEADER_SIZE, 4);
+	put_le_unsigned(header, graph_cnt, 8);
+	put_le_unsigned(header, dir_offset, 8);
+	put_le_double(header, h_period);
+	put_le_unsigned(header, 0, 8);
+
+	RASSERT(header.size() == HEADER_SIZE);
+	os_.write(&header[0], header.size());
+}
+
+/*===========================================================================*/
+void TGBWriter::write_block() {
+	if (! block_.empty()) {
+		os_.write(&block_[0], block_.size());
+		offset_ += block_.size();
+		block_.clear();
+	}
+}
@@ -0,0 +1,73 @@
+// Copyright 2008 by Robert Dick, David Rhodes, and Keith Vallerio.
+// All rights reserved.
+
+#ifndef TGB_WRITER_H_
+#define TGB_WRITER_H_
+
+/*###########################################################################*/
+#include "RVector.h"
+
+#include <string>
+#include <fstream>
+
+/*===========================================================================*/
+/* Writes the binary task graph container (.tgffb).  Everything is
+little-endian and every section starts on an 8-byte boundary, so a consumer
+can mmap the file and index it in place.
+
+File header, 48 bytes:
+	0	char[8]	magic "TGFFBIN\0"
+	8	u32		version (TGB_VERSION)
+	12	u32		header size in bytes
+	16	u64		graph count
+	24	u64		file offset of the directory
+	32	f64		hyperperiod, or -1 if there is none
+	40	u64		reserved
+
+Graph blocks follow, one per task graph, as laid out by TG::print_to_tgb().
+Each starts with its own u64 size in bytes.  The directory, at the end of the
+file, holds the u64 file offset of every graph block in order. */
+
+class TGBWriter {
+public:
+	static const unsigned long TGB_VERSION = 1;
+
+	TGBWriter();
+
+	bool is_open() const { return os_.is_open(); }
+	void open(const std::string & file_name);
+
+// Writes the directory and fills in the header.
+	void close(double h_period);
+
+// Graph blocks are built in memory, then written whole.
+	void begin_graph();
+	void end_graph();
+
+	void put_u8(unsigned v);
+	void put_u32(unsigned long v);
+	void put_i64(long v);
+	void put_f64(double v);
+
+// u32 length, then the bytes, unterminated.
+	void put_string(const std::string & s);
+
+// Pads the block to the next 8-byte boundary.
+	void align();
+
+private:
+	TGBWriter(const TGBWriter &);
+	TGBWriter & operator=(const TGBWriter &);
+
+	void write_header(unsigned long graph_cnt, unsigned long dir_offset,
+		double h_period);
+	void write_block();
+
+		std::ofstream os_;
+		rstd::RVector<char> block_;
+		rstd::RVector<unsigned long> dir_;
+		unsigned long offset_;
+};
+
+/*###########################################################################*/
+#endif
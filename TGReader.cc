@@ -0,0 +1,980 @@
+// Copyright 2008 by Robert Dick, David Rhodes, and Keith Vallerio.
+// All rights reserved.
+
+#include "TGReader.h"
+
+#include "ArgPack.h"
+#include "PGraph.h"
+#include "RGen.h"
+#include "RStd.h"
+#include "RThread.h"
+#include "TGBWriter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace rstd;
+
+/*###########################################################################*/
+namespace {
+
+// A token or line within the mapped file.
+class Span {
+public:
+	Span() : b(0), e(0) {}
+	Span(const char * begin, const char * end) : b(begin), e(end) {}
+
+	bool empty() const { return b == e; }
+	long size() const { return e - b; }
+	string str() const { return string(b, e); }
+
+	bool equals(const char * s) const {
+		const long n = strlen(s);
+		return size() == n && ! memcmp(b, s, n);
+	}
+
+		const char * b;
+		const char * e;
+};
+
+/*===========================================================================*/
+bool is_space(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Splits the next whitespace-delimited token off the front of line.
+Span next_token(Span & line) {
+	const char * p = line.b;
+	while (p != line.e && is_space(*p)) {
+		++p;
+	}
+
+	const char * q = p;
+	while (q != line.e && ! is_space(*q)) {
+		++q;
+	}
+
+	line.b = q;
+	return Span(p, q);
+}
+
+// Splits the next line, without its newline, off the front of [p, end).
+Span next_line(const char * & p, const char * end) {
+	const char * nl = static_cast<const char *>(memchr(p, '\n', end - p));
+	const Span line(p, nl ? nl : end);
+	p = nl ? nl + 1 : end;
+	return line;
+}
+
+/*===========================================================================*/
+bool to_long(Span s, long & v) {
+	const char * p = s.b;
+	const bool neg = p != s.e && *p == '-';
+	if (p != s.e && (*p == '-' || *p == '+')) {
+		++p;
+	}
+
+	if (p == s.e) {
+		return false;
+	}
+
+	long r = 0;
+	for (; p != s.e; ++p) {
+		if (*p < '0' || *p > '9') {
+			return false;
+		}
+
+		r = r * 10 + (*p - '0');
+	}
+
+	v = neg ? -r : r;
+	return true;
+}
+
+// The mapping need not be terminated, so strtod() works on a copy.
+bool to_double(Span s, double & v) {
+	char buf[64];
+	if (s.empty() || s.size() >= static_cast<long>(sizeof(buf))) {
+		return false;
+	}
+
+	memcpy(buf, s.b, s.size());
+	buf[s.size()] = '\0';
+
+	char * end;
+	v = strtod(buf, &end);
+	return end == buf + s.size();
+}
+
+// Splits names such as t0_12 into 0 and 12.  The first part may be empty.
+bool split_name(Span s, long & prefix, long & suffix) {
+	const char * us = s.e;
+	while (us != s.b && us[-1] != '_') {
+		--us;
+	}
+
+	if (us == s.b || ! to_long(Span(us, s.e), suffix)) {
+		return false;
+	}
+
+	prefix = -1;
+	const Span head(s.b + 1, us - 1);
+	return head.empty() || to_long(head, prefix);
+}
+
+// The vertex of the task named name, or -1 if there is none.
+long task_vertex(const RVector<long> & index_of, long name) {
+	if (name < 0 || name >= static_cast<long>(index_of.size())) {
+		return -1;
+	}
+
+	return index_of[name];
+}
+
+// An ARC line, kept until the whole block has been read.
+struct ArcLine {
+	long line;
+	long name;
+	long from;
+	long to;
+	long type;
+};
+
+/* Arc endpoints name tasks, as in hand-written files.  TG::print_to writes
+vertex positions instead, which differ from the names in pack_schedule output,
+so positions are used if some endpoint names no task.  pack_schedule names
+increase through a block, so when every task has an arc, all endpoints are
+names only if each name equals its position. */
+bool arcs_by_name(const RVector<long> & index_of, const RVector<ArcLine> & arc) {
+	MAP(x, arc.size()) {
+		if (task_vertex(index_of, arc[x].from) < 0 ||
+			task_vertex(index_of, arc[x].to) < 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// The vertex at position pos, or -1 if there is none.
+long position_vertex(long size, long pos) {
+	return pos >= 0 && pos < size ? pos : -1;
+}
+
+/*===========================================================================*/
+/* Reads the little-endian values TGBWriter writes, from [begin, end).
+Reading past end sets bad and gives zeros. */
+
+class Cursor {
+public:
+	Cursor(const char * begin, const char * end) :
+		bad(false), b_(begin), p_(begin), e_(end) {}
+
+	void skip(long n) { take(n); }
+	unsigned long get_u(int n);
+	long get_i64() { return static_cast<long>(get_u(8)); }
+	double get_f64();
+	string get_string();
+
+// Skips to the next 8-byte boundary from begin.
+	void align() { take((8 - (p_ - b_) % 8) % 8); }
+
+// True if n values of size bytes each remain.
+	bool has(long n, long size) const {
+		return n >= 0 && n <= (e_ - p_) / size;
+	}
+
+		bool bad;
+
+private:
+	const char * take(long n);
+
+		const char * b_;
+		const char * p_;
+		const char * e_;
+};
+
+const char * Cursor::take(long n) {
+	if (bad || n < 0 || n > e_ - p_) {
+		bad = true;
+		return 0;
+	}
+
+	const char * at = p_;
+	p_ += n;
+	return at;
+}
+
+unsigned long Cursor::get_u(int n) {
+	const char * at = take(n);
+	unsigned long v = 0;
+	for (int x = at ? n - 1 : -1; x >= 0; --x) {
+		v = (v << 8) | static_cast<unsigned char>(at[x]);
+	}
+
+	return v;
+}
+
+double Cursor::get_f64() {
+	const unsigned long bits = get_u(8);
+	RASSERT(sizeof(bits) == 8 && sizeof(double) == 8);
+
+	double v;
+	memcpy(&v, &bits, 8);
+	return v;
+}
+
+string Cursor::get_string() {
+	const long n = get_u(4);
+	const char * at = take(n);
+	return at ? string(at, n) : string();
+}
+
+/*===========================================================================*/
+void fail(long line, const char * what, string & error) {
+	ostringstream os;
+	os << "line " << line << ": " << what;
+	error = os.str();
+}
+
+}
+
+/*###########################################################################*/
+// An @ block: its label, number and the lines between the braces.
+
+class TGReader::Block {
+public:
+	Block() : label(), number(-1), body(), line(0), is_graph(false), slot(0) {}
+
+		Span label;
+		long number;
+		Span body;
+		long line;
+		bool is_graph;
+		long slot;
+};
+
+/*===========================================================================*/
+// Parses blocks into their slots, one block per call.
+
+class TGReader::Parser {
+public:
+	Parser(TGReader & reader, const RVector<Block> & block,
+		RVector<string> & error) :
+		reader_(reader), block_(block), error_(error) {}
+
+	void operator()(long i) {
+		const Block & b = block_[i];
+		if (b.is_graph) {
+			parse_graph(b, reader_.graph_[b.slot], error_[i]);
+		} else {
+			parse_table(b, reader_.table_[b.slot], error_[i]);
+		}
+	}
+
+private:
+	static void parse_graph(const Block & b, TGRecord & g, string & error);
+	static void parse_table(const Block & b, TGTable & t, string & error);
+
+		TGReader & reader_;
+		const RVector<Block> & block_;
+		RVector<string> & error_;
+};
+
+/*===========================================================================*/
+void TGReader::Parser::parse_graph(const Block & b, TGRecord & g,
+string & error) {
+	g.label = b.label.str();
+	g.number = b.number;
+
+// Task names to vertex indices, for arcs and deadlines.
+	RVector<long> index_of;
+	RVector<ArcLine> arc;
+	long tg_number = 0;
+	double period = -1.0;
+	long aperiod = -1;
+
+	long line = b.line;
+	for (const char * p = b.body.b; p != b.body.e; ++line) {
+		Span rest = next_line(p, b.body.e);
+		const Span key = next_token(rest);
+
+		if (key.empty() || *key.b == '#') {
+			continue;
+		}
+
+		if (key.equals("PERIOD")) {
+			if (! to_double(next_token(rest), period)) {
+				return fail(line, "bad PERIOD", error);
+			}
+		} else if (key.equals("APERIODIC")) {
+			const Span t = next_token(rest);
+			if (! t.empty() && ! to_long(t, aperiod)) {
+				return fail(line, "bad APERIODIC", error);
+			}
+		} else if (key.equals("TASK")) {
+			long prefix, name, type;
+			if (! split_name(next_token(rest), prefix, name) || name < 0 ||
+				! next_token(rest).equals("TYPE") ||
+				! to_long(next_token(rest), type))
+			{
+				return fail(line, "bad TASK", error);
+			}
+
+			TGnode n;
+			n.name = name;
+			n.type = type;
+
+			for (Span a = next_token(rest); ! a.empty(); a = next_token(rest)) {
+				double v;
+				if (! to_double(next_token(rest), v)) {
+					return fail(line, "bad TASK attribute", error);
+				}
+
+				if (! g.graph.size_vertex()) {
+					g.attrib_name.push_back(a.str());
+				}
+
+				n.attrib_.push_back(v);
+			}
+
+			if (! g.graph.size_vertex()) {
+				tg_number = prefix;
+			}
+
+			if (name >= static_cast<long>(index_of.size())) {
+				index_of.resize(name + 1, -1);
+			}
+
+			index_of[name] = g.graph.size_vertex();
+			g.graph.add_vertex(n);
+		} else if (key.equals("ARC")) {
+			long prefix, name, from, to, type;
+			if (! split_name(next_token(rest), prefix, name) ||
+				! next_token(rest).equals("FROM") ||
+				! split_name(next_token(rest), prefix, from) ||
+				! next_token(rest).equals("TO") ||
+				! split_name(next_token(rest), prefix, to) ||
+				! next_token(rest).equals("TYPE") ||
+				! to_long(next_token(rest), type))
+			{
+				return fail(line, "bad ARC", error);
+			}
+
+			const ArcLine a = { line, name, from, to, type };
+			arc.push_back(a);
+		} else if (key.equals("HARD_DEADLINE") || key.equals("SOFT_DEADLINE")) {
+			long prefix, name;
+			double at;
+			next_token(rest);
+			if (! next_token(rest).equals("ON") ||
+				! split_name(next_token(rest), prefix, name) ||
+				! next_token(rest).equals("AT") ||
+				! to_double(next_token(rest), at))
+			{
+				return fail(line, "bad deadline", error);
+			}
+
+			const long v = task_vertex(index_of, name);
+			if (v < 0) {
+				return fail(line, "deadline on unknown TASK", error);
+			}
+
+			TGnode & n = g.graph[v];
+			n.deadline = at;
+			n.hard = key.equals("HARD_DEADLINE");
+		} else {
+			return fail(line, "unknown task graph entry", error);
+		}
+	}
+
+	const bool by_name = arcs_by_name(index_of, arc);
+	const long size = g.graph.size_vertex();
+	MAP(x, arc.size()) {
+		const ArcLine & a = arc[x];
+		const long from = by_name ? task_vertex(index_of, a.from) :
+			position_vertex(size, a.from);
+		const long to = by_name ? task_vertex(index_of, a.to) :
+			position_vertex(size, a.to);
+
+		if (from < 0 || to < 0) {
+			return fail(a.line, "ARC to unknown TASK", error);
+		}
+
+		g.graph.add_edge(from, to, TGarc(a.name, a.type));
+	}
+
+	g.graph.init(tg_number, -1, -1, period);
+	g.graph.set_aperiod(aperiod);
+	g.graph.compute_dims();
+}
+
+/*===========================================================================*/
+void TGReader::Parser::parse_table(const Block & b, TGTable & t,
+string & error) {
+	t.label = b.label.str();
+	t.number = b.number;
+
+	bool want_attrib = false;
+
+	long line = b.line;
+	for (const char * p = b.body.b; p != b.body.e; ++line) {
+		Span rest = next_line(p, b.body.e);
+		Span key = next_token(rest);
+
+		if (key.empty()) {
+			continue;
+		}
+
+		if (*key.b == '#') {
+// Separator lines are all dashes.
+			if (key.size() > 1 && key.b[1] == '-') {
+				continue;
+			}
+
+			RVector<string> name;
+			if (key.size() > 1) {
+				name.push_back(Span(key.b + 1, key.e).str());
+			}
+
+			for (key = next_token(rest); ! key.empty(); key = next_token(rest)) {
+				name.push_back(key.str());
+			}
+
+			if (name.empty()) {
+				continue;
+			}
+
+			if (name[0] == "type") {
+				t.column_name = name;
+				want_attrib = false;
+			} else if (t.attrib_name.empty()) {
+				t.attrib_name = name;
+				want_attrib = true;
+			}
+
+			continue;
+		}
+
+		RVector<double> value;
+		for (; ! key.empty(); key = next_token(rest)) {
+			double v;
+			if (! to_double(key, v)) {
+				return fail(line, "bad table value", error);
+			}
+
+			value.push_back(v);
+		}
+
+		if (want_attrib) {
+			t.attrib = value;
+			want_attrib = false;
+		} else {
+			t.row.push_back(value);
+		}
+	}
+}
+
+/*###########################################################################*/
+TGReader::TGReader() :
+	h_period_(-1.0),
+	graph_(),
+	table_(),
+	error_()
+{}
+
+/*===========================================================================*/
+bool TGReader::read(const string & file_name, int threads) {
+	return read_file(file_name, false, threads);
+}
+
+/*===========================================================================*/
+bool TGReader::read_tgb(const string & file_name) {
+	return read_file(file_name, true, 1);
+}
+
+/*===========================================================================*/
+bool TGReader::read_file(const string & file_name, bool binary,
+int threads) {
+	h_period_ = -1.0;
+	graph_.clear();
+	table_.clear();
+	error_.clear();
+
+	const int fd = open(file_name.c_str(), O_RDONLY);
+	if (fd < 0) {
+		error_ = file_name + ": unable to open";
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st)) {
+		close(fd);
+		error_ = file_name + ": unable to stat";
+		return false;
+	}
+
+	if (! st.st_size) {
+		close(fd);
+		if (binary) {
+			error_ = file_name + ": not a .tgffb file";
+		}
+
+		return ! binary;
+	}
+
+	void * map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED) {
+		error_ = file_name + ": unable to map";
+		return false;
+	}
+
+	const char * begin = static_cast<const char *>(map);
+	const bool ok = binary ? parse_tgb(begin, begin + st.st_size) :
+		parse(begin, begin + st.st_size, threads);
+	munmap(map, st.st_size);
+
+	if (! ok) {
+		error_ = file_name + ": " + error_;
+	}
+
+	return ok;
+}
+
+/*===========================================================================*/
+bool TGReader::parse(const char * begin, const char * end, int threads) {
+	RVector<Block> block;
+
+// Find the blocks.  Only their first entries are looked at here.
+	long line = 1;
+	for (const char * p = begin; p != end; ++line) {
+		Span rest = next_line(p, end);
+		const Span key = next_token(rest);
+
+		if (key.empty() || *key.b != '@') {
+			continue;
+		}
+
+		if (key.equals("@HYPERPERIOD")) {
+			if (! to_double(next_token(rest), h_period_)) {
+				fail(line, "bad @HYPERPERIOD", error_);
+				return false;
+			}
+
+			continue;
+		}
+
+		Block b;
+		b.label = Span(key.b + 1, key.e);
+
+		Span t = next_token(rest);
+		if (! t.equals("{")) {
+			if (! to_long(t, b.number)) {
+				fail(line, "bad block number", error_);
+				return false;
+			}
+
+			t = next_token(rest);
+		}
+
+		if (! t.equals("{")) {
+			fail(line, "expected {", error_);
+			return false;
+		}
+
+		b.line = line + 1;
+		b.body = Span(p, p);
+
+		bool first = true;
+		while (1) {
+			if (p == end) {
+				fail(b.line - 1, "block is not closed", error_);
+				return false;
+			}
+
+			const char * line_begin = p;
+			Span inner = next_line(p, end);
+			++line;
+
+			const Span k = next_token(inner);
+			if (k.equals("}")) {
+				b.body.e = line_begin;
+				break;
+			}
+
+			if (first && ! k.empty() && *k.b != '#') {
+				b.is_graph = k.equals("TASK") || k.equals("PERIOD") ||
+					k.equals("APERIODIC");
+				first = false;
+			}
+		}
+
+		b.slot = b.is_graph ? graph_.size() : table_.size();
+		if (b.is_graph) {
+			graph_.push_back(TGRecord());
+		} else {
+			table_.push_back(TGTable());
+		}
+
+		block.push_back(b);
+	}
+
+	RVector<string> error(block.size());
+	parallel_map(block.size(), threads, Parser(*this, block, error));
+
+	MAP(x, error.size()) {
+		if (! error[x].empty()) {
+			error_ = error[x];
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*===========================================================================*/
+bool TGReader::parse_tgb(const char * begin, const char * end) {
+	const char magic[8] = { 'T', 'G', 'F', 'F', 'B', 'I', 'N', '\0' };
+	if (end - begin < 8 || memcmp(begin, magic, 8)) {
+		error_ = "not a .tgffb file";
+		return false;
+	}
+
+	Cursor head(begin, end);
+	head.skip(8);
+	const unsigned long version = head.get_u(4);
+	const unsigned long header_size = head.get_u(4);
+	const long graph_cnt = head.get_i64();
+	const long dir_offset = head.get_i64();
+	h_period_ = head.get_f64();
+
+	if (! head.bad && version != TGBWriter::TGB_VERSION) {
+		error_ = "unsupported .tgffb version";
+		return false;
+	}
+
+	Cursor dir(begin, end);
+	dir.skip(dir_offset);
+// The header is 48 bytes; see TGBWriter.h.
+	if (head.bad || header_size != 48 || ! dir.has(graph_cnt, 8)) {
+		error_ = "bad .tgffb header";
+		return false;
+	}
+
+	graph_.resize(graph_cnt);
+	MAP(x, graph_cnt) {
+// Each block is bounded by its own size.
+		const long offset = dir.get_i64();
+		Cursor c(begin, end);
+		c.skip(offset);
+		const long size = c.get_i64();
+		if (c.bad || size < 8 || size > end - begin - offset) {
+			error_ = "bad .tgffb directory";
+			return false;
+		}
+
+		c = Cursor(begin + offset, begin + offset + size);
+		c.skip(8);
+
+		TGRecord & g = graph_[x];
+		g.number = c.get_i64();
+		const long t_cnt = c.get_i64();
+		const long a_cnt = c.get_i64();
+		const long n_cnt = c.get_i64();
+		const double period = c.get_f64();
+		const long aperiod = c.get_i64();
+
+		if (! c.has(t_cnt, 8) || ! c.has(t_cnt + 1, 8) || ! c.has(a_cnt, 8) ||
+			! c.has(n_cnt, 4))
+		{
+			error_ = "bad .tgffb graph block";
+			return false;
+		}
+
+		g.label = c.get_string();
+		MAP(y, n_cnt) {
+			g.attrib_name.push_back(c.get_string());
+		}
+		c.align();
+
+		RVector<TGnode> node(t_cnt);
+		MAP(y, t_cnt) {
+			node[y].name = c.get_i64();
+		}
+
+		MAP(y, t_cnt) {
+			node[y].type = c.get_i64();
+		}
+
+		MAP(y, t_cnt) {
+			node[y].attrib_.resize(n_cnt);
+			MAP(z, n_cnt) {
+				node[y].attrib_[z] = c.get_f64();
+			}
+		}
+
+// Tasks without deadlines read as from a .tgff file, with none.
+		MAP(y, t_cnt) {
+			node[y].deadline = max(c.get_f64(), 0.0);
+		}
+
+		MAP(y, t_cnt) {
+			node[y].hard = c.get_u(1);
+		}
+		c.align();
+
+		RVector<long> arc_begin(t_cnt + 1), target(a_cnt), name(a_cnt),
+			type(a_cnt);
+
+		MAP(y, t_cnt + 1) {
+			arc_begin[y] = c.get_i64();
+		}
+
+		MAP(y, a_cnt) {
+			target[y] = c.get_i64();
+		}
+
+		MAP(y, a_cnt) {
+			name[y] = c.get_i64();
+		}
+
+		MAP(y, a_cnt) {
+			type[y] = c.get_i64();
+		}
+
+		if (c.bad || arc_begin[0] || arc_begin[t_cnt] != a_cnt) {
+			error_ = "bad .tgffb graph block";
+			return false;
+		}
+
+		MAP(y, t_cnt) {
+			g.graph.add_vertex(node[y]);
+		}
+
+		MAP(y, t_cnt) {
+			if (arc_begin[y] > arc_begin[y + 1]) {
+				error_ = "bad .tgffb arc offsets";
+				return false;
+			}
+
+			for (long z = arc_begin[y]; z < arc_begin[y + 1]; ++z) {
+				if (target[z] < 0 || target[z] >= t_cnt) {
+					error_ = "bad .tgffb arc target";
+					return false;
+				}
+
+				g.graph.add_edge(y, target[z], TGarc(name[z], type[z]));
+			}
+		}
+
+		g.graph.init(g.number, -1, -1, period);
+		g.graph.set_aperiod(aperiod);
+		g.graph.compute_dims();
+	}
+
+	return true;
+}
+
+/*###########################################################################*/
+namespace {
+
+// Writes text to file_name and reads it back.
+bool read_text(TGReader & reader, const char * file_name, const string & text) {
+	{
+		ofstream os(file_name);
+		os << text;
+	}
+
+	const bool ok = reader.read(file_name);
+	remove(file_name);
+	return ok;
+}
+
+}
+
+/*===========================================================================*/
+void TGReader_test() {
+	const string opts = "task_attrib area 10 3 1, power 5 2 0.5\n";
+	ArgJob job;
+	job.opt_text = &opts;
+	ArgPack ap(job);
+
+	const char * file_name = "TGReader_test.tgff";
+	TGReader reader;
+
+// A generated graph, written by TG::print_to and read back.
+	RGen::gen().set_seed(1);
+	TG tg;
+	tg.init(40, ap.vertex_in_deg, ap.vertex_out_deg, 3, 0);
+	tg.set_period(400.0);
+
+	MAP(x, tg.size_vertex()) {
+		tg[x].type = x % 5;
+	}
+
+	MAP(x, tg.size_edge()) {
+		tg(x).type = x % 3;
+	}
+
+	ostringstream text;
+	text << "@HYPERPERIOD 400\n\n@TASK_GRAPH 3 {\n";
+	tg.print_to(text);
+
+	RASSERT(read_text(reader, file_name, text.str()));
+	RASSERT(reader.h_period() == 400.0 && reader.size_graph() == 1);
+
+	const TGRecord & rec = reader.graph(0);
+	const TG & back = rec.graph;
+	RASSERT(rec.label == "TASK_GRAPH" && rec.number == 3);
+	RASSERT(rec.attrib_name == ap.task_attrib_name);
+	RASSERT(back.period() == 400.0);
+	RASSERT(back.size_vertex() == tg.size_vertex());
+	RASSERT(back.size_edge() == tg.size_edge());
+
+	MAP(x, tg.size_vertex()) {
+		RASSERT(back[x].name == tg[x].name && back[x].type == tg[x].type);
+		RASSERT(back[x].attrib_ == tg[x].attrib_);
+
+// Only positive deadlines are written.
+		if (tg[x].deadline <= 0.0) {
+			RASSERT(back[x].deadline <= 0.0);
+			continue;
+		}
+
+		const double deadline = tg[x].hard ? tg[x].deadline :
+			tg[x].deadline * ap.soft_deadline_mul;
+		RASSERT(back[x].hard == tg[x].hard);
+		RASSERT(fabs(back[x].deadline - deadline) <= 1e-5 * deadline);
+	}
+
+	MAP(x, tg.size_edge()) {
+		RASSERT(back.edge(x)->from() == tg.edge(x)->from());
+		RASSERT(back.edge(x)->to() == tg.edge(x)->to());
+		RASSERT(back(x).name == tg(x).name && back(x).type == tg(x).type);
+	}
+
+// The same graph through a .tgffb file.
+	const char * tgb_name = "TGReader_test.tgffb";
+	{
+		TGBWriter out;
+		out.open(tgb_name);
+		tg.print_to_tgb(out, 3);
+		out.close(400.0);
+	}
+
+	string bytes;
+	{
+		ifstream is(tgb_name, ios::binary);
+		bytes.assign(istreambuf_iterator<char>(is), istreambuf_iterator<char>());
+	}
+
+	const bool tgb_ok = reader.read_tgb(tgb_name);
+	RASSERT(tgb_ok && reader.h_period() == 400.0 && reader.size_graph() == 1);
+
+	const TGRecord & brec = reader.graph(0);
+	const TG & bin = brec.graph;
+	RASSERT(brec.label == "TASK_GRAPH" && brec.number == 3);
+	RASSERT(brec.attrib_name == ap.task_attrib_name);
+	RASSERT(bin.period() == 400.0);
+	RASSERT(bin.size_vertex() == tg.size_vertex());
+	RASSERT(bin.size_edge() == tg.size_edge());
+
+	MAP(x, tg.size_vertex()) {
+		RASSERT(bin[x].name == tg[x].name && bin[x].type == tg[x].type);
+		RASSERT(bin[x].attrib_ == tg[x].attrib_);
+
+		if (tg[x].deadline > 0.0) {
+			RASSERT(bin[x].hard == tg[x].hard);
+			RASSERT(bin[x].deadline == (tg[x].hard ? tg[x].deadline :
+				tg[x].deadline * ap.soft_deadline_mul));
+		} else {
+			RASSERT(bin[x].deadline == 0.0);
+		}
+
+// Arcs are listed by source, in out-arc order.
+		RASSERT(bin.vertex(x)->size_out() == tg.vertex(x)->size_out());
+		MAP(y, tg.vertex(x)->size_out()) {
+			const RawGraph::edge_index e = tg.vertex(x)->out(y);
+			const RawGraph::edge_index be = bin.vertex(x)->out(y);
+			RASSERT(bin.edge(be)->to() == tg.edge(e)->to());
+			RASSERT(bin(be).name == tg(e).name && bin(be).type == tg(e).type);
+		}
+	}
+
+// A truncated file is rejected.
+	{
+		ofstream os(tgb_name, ios::binary);
+		os.write(bytes.data(), bytes.size() / 2);
+	}
+
+	RASSERT(! reader.read_tgb(tgb_name));
+	remove(tgb_name);
+
+// Arcs and deadlines name tasks, which need not be numbered in order.
+	const string sparse =
+		"@TASK_GRAPH 1 {\n"
+		"\tAPERIODIC\n\n"
+		"\tTASK t1_7\tTYPE 2\n"
+		"\tTASK t1_3\tTYPE 4\n"
+		"\tARC a1_0 \tFROM t1_7  TO  t1_3 TYPE 1\n"
+		"\tHARD_DEADLINE d1_0 ON t1_3 AT 50\n"
+		"}\n";
+
+	RASSERT(read_text(reader, file_name, sparse));
+	const TG & sg = reader.graph(0).graph;
+	RASSERT(sg.size_vertex() == 2 && sg.size_edge() == 1);
+	RASSERT(sg.edge(0)->from() == 0 && sg.edge(0)->to() == 1);
+	RASSERT(sg[1].deadline == 50.0 && sg[0].deadline == 0.0);
+
+	string unknown = sparse;
+	unknown.replace(unknown.find("TO  t1_3"), 8, "TO  t1_5");
+	RASSERT(! read_text(reader, file_name, unknown));
+
+	string negative = sparse;
+	negative.replace(negative.find("FROM t1_7"), 9, "FROM t1_-7");
+	RASSERT(! read_text(reader, file_name, negative));
+
+// pack_schedule output, whose arcs give vertex positions.  PGraph puts a
+// deadline on each task without children.
+	ostringstream eps, packed;
+	PGraph pg(eps, 2, 8, 1000.0, 250.0, 200.0, 1.0, 3, 4, 1, 1, 0.2);
+	packed << "@HYPERPERIOD " << pg.h_period() << "\n\n";
+	pg.print_to(packed);
+
+	RASSERT(read_text(reader, file_name, packed.str()));
+	RASSERT(reader.size_graph() == 2);
+
+	long arcs = 0;
+	MAP(x, reader.size_graph()) {
+		const TG & pack = reader.graph(x).graph;
+		arcs += pack.size_edge();
+
+		MAP(y, pack.size_vertex()) {
+			RASSERT((pack[y].deadline > 0.0) == ! pack.vertex(y)->size_out());
+		}
+	}
+
+	long arc_lines = 0;
+	for (string::size_type at = packed.str().find("\tARC ");
+		at != string::npos; at = packed.str().find("\tARC ", at + 1))
+	{
+		++arc_lines;
+	}
+
+	RASSERT(arcs == arc_lines);
+}
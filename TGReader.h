@@ -0,0 +1,91 @@
+// Copyright 2008 by Robert Dick, David Rhodes, and Keith Vallerio.
+// All rights reserved.
+
+#ifndef TG_READER_H_
+#define TG_READER_H_
+
+/*###########################################################################*/
+#include "RVector.h"
+#include "TG.h"
+
+#include <string>
+
+/*===========================================================================*/
+/* A task graph block read back from a .tgff file.  Deadlines are as written,
+so soft deadlines already include soft_deadline_mul. */
+
+class TGRecord {
+public:
+	TGRecord() : label(), number(-1), attrib_name(), graph() {}
+
+		std::string label;
+		long number;
+		rstd::RVector<std::string> attrib_name;
+		TG graph;
+};
+
+/*===========================================================================*/
+/* Any other block, such as the @PE tables written by DBase::print_to().
+attrib holds the values under the first commented header line, row the lines
+under the commented column header (e.g. "# type version exec_time"). */
+
+class TGTable {
+public:
+	TGTable() : label(), number(-1), attrib_name(), attrib(), column_name(),
+		row() {}
+
+		std::string label;
+		long number;
+		rstd::RVector<std::string> attrib_name;
+		rstd::RVector<double> attrib;
+		rstd::RVector<std::string> column_name;
+		rstd::RVector<rstd::RVector<double> > row;
+};
+
+/*===========================================================================*/
+/* Reads .tgff files.  The file is memory-mapped and tokenized in place; one
+serial pass finds the @ blocks, which are then parsed on up to threads
+threads.  Lines outside blocks, other than @HYPERPERIOD, are ignored.  Also
+reads the .tgffb files written by tgb_write. */
+
+class TGReader {
+public:
+	TGReader();
+
+// Returns false, with error() set, if the file cannot be read or parsed.
+	bool read(const std::string & file_name, int threads = 1);
+
+/* Reads a .tgffb file (see TGBWriter.h) into graphs; it has no tables.  Each
+task's arcs come in its out-arc order, as the file lists them. */
+	bool read_tgb(const std::string & file_name);
+
+	const std::string & error() const { return error_; }
+
+// -1 if the file has no @HYPERPERIOD.
+	double h_period() const { return h_period_; }
+
+	long size_graph() const { return graph_.size(); }
+	const TGRecord & graph(long i) const { return graph_[i]; }
+
+	long size_table() const { return table_.size(); }
+	const TGTable & table(long i) const { return table_[i]; }
+
+private:
+	class Block;
+	class Parser;
+
+	bool read_file(const std::string & file_name, bool binary, int threads);
+	bool parse(const char * begin, const char * end, int threads);
+	bool parse_tgb(const char * begin, const char * end);
+
+		double h_period_;
+		rstd::RVector<TGRecord> graph_;
+		rstd::RVector<TGTable> table_;
+		std::string error_;
+};
+
+/*###########################################################################*/
+void TGReader_test();
+
+/*###########################################################################*/
+#endif
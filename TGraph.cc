@@ -2,9 +2,11 @@
 // All rights reserved.
 
 #include <cmath>
+#include <cstdlib>
 #include <iostream>
 #include <algorithm>
 #include <set>
+#include <unistd.h>
 
 #include "RMath.h"
 #include "TGraph.h"
@@ -12,19 +14,113 @@
 #include "RGen.h"
 #include "ArgPack.h"
 #include "RAlgo.h"
+#include "RThread.h"
+#include "RWriter.h"
 
 using namespace std;
 using namespace rstd;
 
+/*###########################################################################*/
+namespace {
+
+// Draws the lower bound on a graph's vertex count.
+int draw_vertex_cnt(double per_mul) {
+	double low_bound =
+		RGen::gen().flat_range_d(ArgPack::ap().vertex_cnt_av -
+		ArgPack::ap().vertex_cnt_mul,
+		ArgPack::ap().vertex_cnt_av + ArgPack::ap().vertex_cnt_mul);
+
+// FIXME: MAKE MORE SOPHISTICATED.
+	low_bound *= per_mul;
+
+	return static_cast<int>(rint(low_bound));
+}
+
+}
+
+/*===========================================================================*/
+// Builds graphs on worker threads.
+
+class TGraph::Builder {
+public:
+	explicit Builder(TGraph & tg) : tg_(tg), ap_(ArgPack::write_ap()) {}
+
+	void operator()(long x) {
+		ArgPackBind bind(ap_);
+		x += tg_.first_;
+		tg_.build(x, tg_.dag_[x]);
+		tg_.built(x);
+	}
+
+private:
+		TGraph & tg_;
+		ArgPack & ap_;
+};
+
 /*###########################################################################*/
 TGraph::TGraph(int tg_offset) :
 	dag_(ArgPack::ap().tg_cnt),
 	tg_offset_(tg_offset),
-	h_period_(-1.0)
+	first_(0),
+	last_(dag_.size()),
+	h_period_(-1.0),
+	lbnd_(dag_.size()),
+	size_(dag_.size()),
+	height_(dag_.size()),
+	max_deadline_(dag_.size()),
+	spill_fd_(-1),
+	spill_end_(0),
+	spill_at_(),
+	spill_size_()
+{
+	init();
+}
+
+/*===========================================================================*/
+TGraph::TGraph(int tg_offset, long first, long last) :
+	dag_(ArgPack::ap().tg_cnt),
+	tg_offset_(tg_offset),
+	first_(first),
+	last_(last),
+	h_period_(-1.0),
+	lbnd_(dag_.size()),
+	size_(dag_.size()),
+	height_(dag_.size()),
+	max_deadline_(dag_.size()),
+	spill_fd_(-1),
+	spill_end_(0),
+	spill_at_(),
+	spill_size_()
 {
+	RASSERT(first_ >= 0 && first_ <= last_ && last_ <= dag_.size());
+	init();
+}
+
+/*===========================================================================*/
+TGraph::~TGraph() {
+	if (spill_fd_ >= 0)
+		close(spill_fd_);
+}
 
+/*===========================================================================*/
+void TGraph::init() {
 	if (! dag_.size()) return;
 
+	if (ArgPack::ap().stream_write) {
+		string name = ArgPack::ap().data_file_name + ".XXXXXX";
+		spill_fd_ = mkstemp(&name[0]);
+		if (spill_fd_ < 0) {
+			cout << "Unable to open TGFF spill file.\n";
+			exit(EXIT_FAILURE);
+		}
+
+		unlink(name.c_str());
+		spill_at_.resize(dag_.size());
+		spill_size_.resize(dag_.size());
+	}
+
+	const bool whole = ! first_ && last_ == dag_.size();
+
 // For use when task names must be unique.
 	int first_task = 0;
 
@@ -38,31 +134,41 @@ of the period_mul_ list. */
 	}
 
 // Determine the number of vertices in the graph.
-	MAP(x, dag_.size()) {
-		double low_bound =
-			RGen::gen().flat_range_d(ArgPack::ap().vertex_cnt_av -
-			ArgPack::ap().vertex_cnt_mul,
-			ArgPack::ap().vertex_cnt_av + ArgPack::ap().vertex_cnt_mul);
+	if (! ArgPack::ap().thread_cnt) {
+		RASSERT(whole);
+		MAP(x, dag_.size()) {
+			lbnd_[x] = draw_vertex_cnt(per_mul[x]);
+			dag_[x].init(lbnd_[x], ArgPack::ap().vertex_in_deg,
+			  ArgPack::ap().vertex_out_deg, x, first_task);
+			built(x);
 
-// FIXME: MAKE MORE SOPHISTICATED.
-		low_bound *= per_mul[x];
+			first_task += size_[x];
+		}
+	} else {
+		MAP(x, dag_.size()) {
+			lbnd_[x] = draw_vertex_cnt(per_mul[x]);
+		}
 
-		const int lbnd = static_cast<int>(rint(low_bound));
-		dag_[x].init(lbnd, ArgPack::ap().vertex_in_deg,
-		  ArgPack::ap().vertex_out_deg, x, first_task);
+		parallel_map(last_ - first_, ArgPack::ap().thread_cnt, Builder(*this));
 
-		first_task += dag_[x].size_vertex();
+		MAP(x, dag_.size()) {
+			dag_[x].set_first_task(first_task);
+			first_task += size_[x];
+		}
 	}
 
-	double deadline_grain = 0.0;
+	double deadline_grain = ArgPack::ap().period_grain;
 
-	MAP(x, dag_.size()) {
+	if (eps_equal_to<double>()(deadline_grain, 0.0)) {
+		RASSERT(whole);
+		MAP(x, dag_.size()) {
 // Find the average deadline / period_mul for all graphs.
-		deadline_grain += dag_[x].max_h() * ArgPack::ap().vertex_time /
-			per_mul[x];
-	}
+			deadline_grain += height_[x] * ArgPack::ap().vertex_time /
+				per_mul[x];
+		}
 
-	deadline_grain = deadline_grain / dag_.size() * ArgPack::ap().p_laxity;
+		deadline_grain = deadline_grain / dag_.size() * ArgPack::ap().p_laxity;
+	}
 
 // Figure out the periods.
 //	double deadline_grain =
@@ -99,11 +205,12 @@ increasing deadlines. */
 
 // Ensure that periods >= deadlines if requested.
 	if (ArgPack::ap().p_greater_deadline) {
+		RASSERT(whole);
 		double new_grain = deadline_grain;
 
 		MAP(x, dag_.size()) {
 			double old_period = dag_[x].period();
-			dag_[x].push_period();
+			dag_[x].set_period(max(old_period, max_deadline_[x]));
 
 			double period_dif = dag_[x].period() - old_period;
 			if (period_dif > 0.0) {
@@ -140,31 +247,130 @@ increasing deadlines. */
 // Correct the ArgPack if necessary.
 
 	if (ArgPack::ap().task_unique) {
+		RASSERT(whole);
 		ArgPack::write_ap().task_type_cnt = 0;
 
 		MAP(x, dag_.size()) {
-			ArgPack::write_ap().task_type_cnt += dag_[x].size_vertex();
+			ArgPack::write_ap().task_type_cnt += size_[x];
 		}
 	}
 }
 
 /*===========================================================================*/
 void TGraph::print_to(ostream & os) const {
-	MAP(x, dag_.size()) {
-		os << "@" << ArgPack::ap().tg_label << " " <<
+	RWriter out(os);
+
+	for (long x = first_; x < last_; x++) {
+		RGen own;
+		RGenBind bind(type_gen(x, own));
+
+		out << "@" << ArgPack::ap().tg_label << " " <<
 		  (x + tg_offset_) << " {\n";
 
-		dag_[x].print_to(os);
+		TG scratch;
+		graph(x, scratch).print_to(out);
 	}
 
-	os << "\n\n";
+// Ends the last graph.
+	if (last_ == dag_.size() && (first_ < last_ || dag_.empty())) {
+		out << "\n\n";
+	}
 }
 
 /*===========================================================================*/
 void TGraph::print_to_vcg(ostream & os) const {
+	RASSERT(! first_ && last_ == dag_.size());
+	RWriter out(os);
+
+	MAP(x, dag_.size()) {
+		RGen own;
+		RGenBind bind(type_gen(x, own));
+
+		TG scratch;
+		graph(x, scratch).print_to_vcg(out);
+	}
+
+	out << "\n\n";
+}
+
+/*===========================================================================*/
+void TGraph::print_to_tgb(TGBWriter & out) const {
+	RASSERT(! first_ && last_ == dag_.size());
 	MAP(x, dag_.size()) {
-		dag_[x].print_to_vcg(os);
+		RGen own;
+		RGenBind bind(type_gen(x, own));
+
+		TG scratch;
+		graph(x, scratch).print_to_tgb(out, x + tg_offset_);
+	}
+}
+
+/*===========================================================================*/
+void TGraph::build(long x, TG & tg) const {
+	RGen gen;
+	gen.set_engine(ArgPack::ap().rng_engine);
+	gen.set_seed(ArgPack::ap().seed, tg_offset_ + x);
+
+	RGenBind bind(gen);
+	tg.init(lbnd_[x], ArgPack::ap().vertex_in_deg,
+	  ArgPack::ap().vertex_out_deg, x, 0);
+}
+
+/*===========================================================================*/
+RGen & TGraph::type_gen(long x, RGen & own) const {
+	if (! ArgPack::ap().thread_cnt)
+		return RGen::gen();
+
+/* Build streams count up from 0, type streams down from -2, past the stream
+reserved for the global generator. */
+	own.set_engine(ArgPack::ap().rng_engine);
+	own.set_seed(ArgPack::ap().seed, -2 - (tg_offset_ + x));
+	return own;
+}
+
+/*===========================================================================*/
+void TGraph::built(long x) {
+	size_[x] = dag_[x].size_vertex();
+	height_[x] = dag_[x].max_h();
+	max_deadline_[x] = dag_[x].max_deadline();
+
+	if (! ArgPack::ap().stream_write)
+		return;
+
+	RVector<char> buf;
+	dag_[x].spill_to(buf);
+
+// Builder threads each claim their own part of the file.
+	const long size = buf.size();
+	const long at = __sync_fetch_and_add(&spill_end_, size);
+	if (pwrite(spill_fd_, &buf[0], size, at) != size) {
+		cout << "Unable to write TGFF spill file.\n";
+		exit(EXIT_FAILURE);
+	}
+
+	spill_at_[x] = at;
+	spill_size_[x] = size;
+
+// Keep only the period and task numbering.
+	TG empty;
+	dag_[x].rswap(empty);
+}
+
+/*===========================================================================*/
+const TG & TGraph::graph(long x, TG & scratch) const {
+	if (! ArgPack::ap().stream_write) {
+		return dag_[x];
+	}
+
+	RVector<char> buf(spill_size_[x]);
+	if (pread(spill_fd_, &buf[0], buf.size(), spill_at_[x]) != buf.size()) {
+		cout << "Unable to read TGFF spill file.\n";
+		exit(EXIT_FAILURE);
 	}
 
-	os << "\n\n";
+	scratch.unspill(&buf[0]);
+	scratch.set_first_task(dag_[x].first_task());
+	scratch.set_period(dag_[x].period());
+	scratch.set_aperiod(dag_[x].aperiod());
+	return scratch;
 }
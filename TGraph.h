@@ -8,6 +8,7 @@
 #include "RVector.h"
 #include "TG.h"
 #include "RString.h"
+#include "RGen.h"
 
 #include <iosfwd>
 
@@ -15,15 +16,59 @@
 class TGraph {
 public:
 	TGraph(int offset);
+
+/* Builds and prints only graphs [first, last), for a shard of a run.  Needs
+one stream per graph and a period_grain, so no graph depends on the others,
+and neither task_unique nor p_greater_deadline. */
+	TGraph(int offset, long first, long last);
+	~TGraph();
+
 	void print_to(std::ostream & os) const;
 	void print_to_vcg(std::ostream & os) const;
+	void print_to_tgb(TGBWriter & out) const;
 	void print_to_ps(std::ostream & os, const std::string & filename) const;
 	double h_period() const { return h_period_; }
 
 private:
+	class Builder;
+	friend class Builder;
+
+	TGraph(const TGraph &);
+	TGraph & operator=(const TGraph &);
+
+	void init();
+
+// Builds graph x into tg from its own stream, for thread_cnt.
+	void build(long x, TG & tg) const;
+
+/* Records the shape of graph x.  Under stream_write the graph is then moved
+to the spill file. */
+	void built(long x);
+
+// Graph x ready to print.  Under stream_write it is read back into scratch.
+	const TG & graph(long x, TG & scratch) const;
+
+/* The generator graph x's types are drawn from when printed: own, seeded with
+the graph's type stream, under thread_cnt, and otherwise the shared one. */
+	rstd::RGen & type_gen(long x, rstd::RGen & own) const;
+
 		rstd::RVector<TG> dag_; 
 		int tg_offset_;
+		long first_;
+		long last_;
 		double h_period_;
+
+		rstd::RVector<int> lbnd_;
+		rstd::RVector<int> size_;
+		rstd::RVector<int> height_;
+		rstd::RVector<double> max_deadline_;
+
+/* Under stream_write, built graphs wait in this unlinked file, next to the
+data file, until they are printed.  Each graph has its own range of it. */
+		int spill_fd_;
+		volatile long spill_end_;
+		rstd::RVector<long> spill_at_;
+		rstd::RVector<long> spill_size_;
 };
 
 /*###########################################################################*/
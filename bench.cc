@@ -0,0 +1,478 @@
+// Copyright 2008 by Robert Dick, David Rhodes, and Keith Vallerio.
+// All rights reserved.
+
+/* Microbenchmarks for the generator's hot paths.
+
+	bench [max_vertices]
+
+Each benchmark runs at 1e2, 1e3, ... vertices up to max_vertices (default 1e6)
+and reports the time and the number of operator new calls per vertex.  The
+gen_compat and series-parallel TG::init are quadratic and stop at 1e4, and
+TG::init stops at 1e5.  A RawGraph with ten edges per vertex is then built at
+each size and its heap use reported per edge.  Last, the TASK and ARC lines of
+a TG are written through ostream and through RWriter, and the output rate of
+each reported in MB/s.
+
+Under ROB_DEBUG, which the Makefile sets, every graph change runs an O(v + e)
+self check, so building graphs is quadratic and the default is 1e3.  Build
+without it for meaningful times. */
+
+#include "ArgPack.h"
+#include "DBase.h"
+#include "RGen.h"
+#include "RStd.h"
+#include "RVector.h"
+#include "RWriter.h"
+#include "TG.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <sys/time.h>
+
+using namespace std;
+using namespace rstd;
+
+/*###########################################################################*/
+namespace {
+	long alloc_cnt = 0;
+	long alloc_live = 0;
+
+// Each block is preceded by its size, keeping malloc's alignment.
+	const size_t ALLOC_HEADER = 16;
+}
+
+void * operator new(size_t n) {
+	++alloc_cnt;
+	alloc_live += n;
+
+	char * p = static_cast<char *>(malloc(n + ALLOC_HEADER));
+	if (! p)
+		throw std::bad_alloc();
+
+	*reinterpret_cast<size_t *>(p) = n;
+	return p + ALLOC_HEADER;
+}
+
+void operator delete(void * p) {
+	if (! p)
+		return;
+
+	char * block = static_cast<char *>(p) - ALLOC_HEADER;
+	alloc_live -= *reinterpret_cast<size_t *>(block);
+	free(block);
+}
+
+/*###########################################################################*/
+namespace {
+
+// Minimum time spent on each measurement, in seconds.
+const double MIN_TIME = 0.2;
+
+double now() {
+	timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/*===========================================================================*/
+// Generates a graph of at least n vertices with the current options.
+void make_graph(TG & tg, long n) {
+	RGen::gen().set_seed(1);
+	tg = TG();
+	tg.init(n, ArgPack::ap().vertex_in_deg, ArgPack::ap().vertex_out_deg,
+		0, 0);
+}
+
+RVector<RawGraph::vertex_index> sources(const TG & tg) {
+	RVector<RawGraph::vertex_index> start;
+	MAP(x, tg.size_vertex()) {
+		if (! tg.vertex(x)->size_in())
+			start.push_back(x);
+	}
+
+	return start;
+}
+
+/*===========================================================================*/
+// One benchmark.  setup() is untimed; run() does work proportional to n.
+
+class Bench {
+public:
+	explicit Bench(const char * name, long max_n = 0) :
+		name_(name), max_n_(max_n) {}
+
+	virtual ~Bench() {}
+	virtual void setup(long) {}
+	virtual void run(long n) = 0;
+
+	const char * name() const { return name_; }
+	long max_n() const { return max_n_; }
+
+private:
+		const char * name_;
+		long max_n_;
+};
+
+/*===========================================================================*/
+class FlatBench : public Bench {
+public:
+	FlatBench(const char * name, RGen::Engine e) :
+		Bench(name), gen_(), sum_(0.0) { gen_.set_engine(e); }
+
+	void run(long n) {
+		MAP(x, n) {
+			sum_ += gen_.flat01();
+		}
+	}
+
+private:
+		RGen gen_;
+		double sum_;
+};
+
+class FlatFillBench : public Bench {
+public:
+	FlatFillBench() : Bench("RGen::flat01_fill"), buf_() {}
+
+	void setup(long n) { buf_.resize(n); }
+	void run(long) { RGen::gen().flat01_fill(buf_); }
+
+private:
+		RVector<double> buf_;
+};
+
+/*===========================================================================*/
+class GaussBench : public Bench {
+public:
+	GaussBench(const char * name, RGen::Gauss g, RGen::Engine e) :
+		Bench(name), gen_(), sum_(0.0) { gen_.set_engine(e); gen_.set_gauss(g); }
+
+	void run(long n) {
+		MAP(x, n) {
+			sum_ += gen_.gauss01();
+		}
+	}
+
+private:
+		RGen gen_;
+		double sum_;
+};
+
+/*===========================================================================*/
+// TG::init, which runs TG::augment or the series-parallel construction.
+
+class InitBench : public Bench {
+public:
+	InitBench(const char * name, bool compat, bool sp, long max_n) :
+		Bench(name, max_n), compat_(compat), sp_(sp) {}
+
+	void run(long n) {
+		ArgPack & ap = ArgPack::write_ap();
+		ap.gen_compat = compat_;
+		ap.gen_series_parallel = sp_;
+		ap.series_local_xover = sp_ ? n / 10 : 0;
+		ap.series_global_xover = sp_ ? n / 10 : 0;
+
+		TG tg;
+		make_graph(tg, n);
+
+		ap.gen_compat = true;
+		ap.gen_series_parallel = false;
+		ap.series_local_xover = 0;
+		ap.series_global_xover = 0;
+	}
+
+private:
+		bool compat_;
+		bool sp_;
+};
+
+/*===========================================================================*/
+// Traversals of a graph built by the fast TG::augment, frozen or not.
+
+class GraphBench : public Bench {
+public:
+	explicit GraphBench(const char * name, long max_n = 0,
+	bool frozen = true) :
+		Bench(name, max_n), tg_(), start_(), frozen_(frozen) {}
+
+	void setup(long n) {
+		ArgPack::write_ap().gen_compat = false;
+		make_graph(tg_, n);
+		ArgPack::write_ap().gen_compat = true;
+		start_ = sources(tg_);
+
+		if (! frozen_)
+			tg_.thaw();
+	}
+
+protected:
+		TG tg_;
+		RVector<RawGraph::vertex_index> start_;
+
+private:
+		bool frozen_;
+};
+
+class CyclicBench : public GraphBench {
+public:
+	CyclicBench() : GraphBench("RawGraph::cyclic"), scratch_(),
+		found_(false) {}
+	void run(long) { found_ = found_ || tg_.cyclic(scratch_); }
+
+private:
+		RawGraph::traversal_scratch scratch_;
+		bool found_;
+};
+
+class TopSortBench : public GraphBench {
+public:
+	TopSortBench(const char * name, bool frozen) :
+		GraphBench(name, 0, frozen) {}
+	void run(long) { tg_.top_sort(start_); }
+};
+
+class DfsBench : public GraphBench {
+public:
+	DfsBench(const char * name, bool frozen) : GraphBench(name, 0, frozen) {}
+	void run(long) { tg_.dfs(start_); }
+};
+
+/*===========================================================================*/
+class PrintBench : public GraphBench {
+public:
+	PrintBench() : GraphBench("TG::print_to"), os_("/dev/null") {}
+	void run(long) { tg_.print_to(os_); }
+
+private:
+		ofstream os_;
+};
+
+/*===========================================================================*/
+// DBase with one task type per vertex.
+
+class DBaseBench : public Bench {
+public:
+	DBaseBench() : Bench("DBase::DBase") {}
+
+	void run(long n) {
+		RGen::gen().set_seed(1);
+		DBase db(0, n);
+	}
+};
+
+/*===========================================================================*/
+void measure(Bench & b, long n) {
+	cout << setw(28) << b.name() << setw(10) << n;
+
+	if (b.max_n() && n > b.max_n()) {
+		cout << setw(14) << "-" << setw(16) << "-" << "\n";
+		return;
+	}
+
+	b.setup(n);
+
+	long reps = 0;
+	const long alloc_begin = alloc_cnt;
+	const double begin = now();
+	double end;
+
+	do {
+		b.run(n);
+		++reps;
+		end = now();
+	} while (end - begin < MIN_TIME);
+
+	const double per = static_cast<double>(reps) * n;
+	cout << setw(14) << fixed << setprecision(1) <<
+		(end - begin) * 1e9 / per <<
+		setw(16) << setprecision(3) << (alloc_cnt - alloc_begin) / per << "\n";
+	cout.flush();
+}
+
+
+/*===========================================================================*/
+// Heap bytes per edge of a RawGraph with EDGES_PER_VERTEX out-edges a vertex.
+
+const long EDGES_PER_VERTEX = 10;
+
+void measure_memory(long n) {
+	cout << setw(28) << "RawGraph" << setw(10) << n;
+
+	const long live_begin = alloc_live;
+	RawGraph g;
+	MAP(x, n) {
+		g.add_vertex();
+	}
+
+	MAP(x, n) {
+		for (long y = x + 1; y <= x + EDGES_PER_VERTEX && y < n; ++y) {
+			g.add_edge(x, y);
+		}
+	}
+
+	const double e_cnt = g.size_edge();
+	const double thawed = alloc_live - live_begin;
+	g.freeze();
+	const double frozen = alloc_live - live_begin;
+
+	cout << setw(14) << g.size_edge() << setw(16) << fixed <<
+		setprecision(1) << thawed / e_cnt << setw(16) << frozen / e_cnt << "\n";
+	cout.flush();
+}
+
+
+/*===========================================================================*/
+/* The TASK and ARC lines of TG::print_to, with three attributes a task.  The
+template gives ostream and RWriter the same formatting calls. */
+
+const char * const ATTRIB_NAME[] = { "area", "power", "exec_time" };
+const long ATTRIB_CNT = sizeof(ATTRIB_NAME) / sizeof(ATTRIB_NAME[0]);
+
+template <typename OUT>
+void write_graph(OUT & out, const TG & tg) {
+	MAP(x, tg.size_vertex()) {
+		out << "\tTASK t0_" << tg[x].name << "\tTYPE " << tg[x].type << " ";
+
+		MAP(y, ATTRIB_CNT) {
+			out << ATTRIB_NAME[y] << " " << tg[x].attrib_[y] << " ";
+		}
+		out << "\n";
+	}
+
+	out << "\n";
+
+	MAP(x, tg.size_edge()) {
+		out << "\tARC a0_" << tg(x).name << " \tFROM t0_" <<
+			static_cast<long>(tg.edge(x)->from()) << "  TO  t0_" <<
+			static_cast<long>(tg.edge(x)->to()) << " TYPE " << tg(x).type << '\n';
+	}
+}
+
+// MB/s of write_graph() through a fresh RWriter or straight to the stream.
+double write_rate(ostream & os, const TG & tg, double mb, bool writer) {
+	long reps = 0;
+	const double begin = now();
+	double end;
+
+	do {
+		if (writer) {
+			RWriter out(os);
+			write_graph(out, tg);
+		} else {
+			write_graph(os, tg);
+		}
+
+		os.flush();
+		++reps;
+		end = now();
+	} while (end - begin < MIN_TIME);
+
+	return reps * mb / (end - begin);
+}
+
+void measure_writer(long n) {
+	cout << setw(28) << "TG text" << setw(10) << n;
+
+	TG tg;
+	ArgPack::write_ap().gen_compat = false;
+	make_graph(tg, n);
+	ArgPack::write_ap().gen_compat = true;
+
+	MAP2(x, tg.size_vertex(), y, ATTRIB_CNT) {
+		tg[x].attrib_.push_back(RGen::gen().flat_range_d(0.0, 1000.0));
+	}
+
+// Both paths must give the same bytes.
+	ostringstream by_stream, by_writer;
+	write_graph(by_stream, tg);
+	{
+		RWriter out(by_writer);
+		write_graph(out, tg);
+	}
+
+	RASSERT(by_stream.str() == by_writer.str());
+	const double mb = by_stream.str().size() * 1e-6;
+
+	ofstream os("/dev/null");
+	const double stream_rate = write_rate(os, tg, mb, false);
+	const double writer_rate = write_rate(os, tg, mb, true);
+
+	cout << setw(14) << fixed << setprecision(3) << mb <<
+		setw(16) << setprecision(1) << stream_rate <<
+		setw(16) << writer_rate << "\n";
+	cout.flush();
+}
+
+}
+
+/*###########################################################################*/
+int main(int argc, char * argv[]) {
+#ifdef ROB_DEBUG
+	long max_n = 1000;
+#else
+	long max_n = 1000000;
+#endif
+	if (argc > 2 || (argc == 2 && (max_n = atol(argv[1])) < 100)) {
+		cout << "bench [max_vertices]\n";
+		exit(EXIT_FAILURE);
+	}
+
+// Default options, without output files.
+	const string no_opts;
+	ArgJob job;
+	job.opt_text = &no_opts;
+	ArgPack ap(job);
+
+	FlatBench flat("RGen::flat01", RGen::MARSAGLIA);
+	FlatBench xoshiro("RGen::flat01 xoshiro256ss", RGen::XOSHIRO256SS);
+	FlatBench philox("RGen::flat01 philox", RGen::PHILOX4X32);
+	FlatFillBench flat_fill;
+	GaussBench gauss("RGen::gauss01", RGen::BOX_MULLER, RGen::MARSAGLIA);
+	GaussBench zig("RGen::gauss01 ziggurat", RGen::ZIGGURAT, RGen::MARSAGLIA);
+	GaussBench zig_x("RGen::gauss01 zig xoshiro", RGen::ZIGGURAT,
+		RGen::XOSHIRO256SS);
+	InitBench augment_compat("TG::init gen_compat", true, false, 10000);
+	InitBench augment("TG::init", false, false, 100000);
+	InitBench sp("TG::init series_parallel", true, true, 10000);
+	CyclicBench cyclic;
+	TopSortBench top_sort("RawGraph::top_sort", true);
+	TopSortBench top_sort_thawed("RawGraph::top_sort thawed", false);
+	DfsBench dfs("RawGraph::dfs", true);
+	DfsBench dfs_thawed("RawGraph::dfs thawed", false);
+	DBaseBench dbase;
+	PrintBench print;
+
+	Bench * bench[] = { &flat, &xoshiro, &philox, &flat_fill, &gauss, &zig,
+		&zig_x, &augment_compat, &augment, &sp, &cyclic, &top_sort,
+		&top_sort_thawed, &dfs, &dfs_thawed, &dbase, &print };
+
+	cout << setw(28) << "benchmark" << setw(10) << "vertices" <<
+		setw(14) << "ns/vertex" << setw(16) << "allocs/vertex" << "\n";
+
+	MAP(x, sizeof(bench) / sizeof(bench[0])) {
+		for (long n = 100; n <= max_n; n *= 10) {
+			measure(*bench[x], n);
+		}
+	}
+
+	cout << "\n" << setw(28) << "graph" << setw(10) << "vertices" <<
+		setw(14) << "edges" << setw(16) << "bytes/edge" <<
+		setw(16) << "frozen" << "\n";
+
+	for (long n = 100; n <= max_n; n *= 10) {
+		measure_memory(n);
+	}
+
+	cout << "\n" << setw(28) << "output" << setw(10) << "vertices" <<
+		setw(14) << "MB" << setw(16) << "ostream MB/s" <<
+		setw(16) << "RWriter MB/s" << "\n";
+
+	for (long n = 100; n <= max_n; n *= 10) {
+		measure_writer(n);
+	}
+}
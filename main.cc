@@ -8,5 +8,5 @@ using namespace rstd;
 
 /*###########################################################################*/
 int main(int argc, char *argv[]) {
-	ArgPack ap(argc, argv);
+	ArgPack::run(argc, argv);
 }
@@ -22,7 +22,8 @@ static const int PSyoff = 50;
 static const int PSwidth = 500;
 static const int PSheight = 628;
 
-static int	X_min, Y_min,	// actual x/y mins/max used (for BB)
+// Per thread, as batch jobs may plot at the same time.
+static __thread int	X_min, Y_min,	// actual x/y mins/max used (for BB)
 			X_max, Y_max;
 
 /*===========================================================================*/
@@ -37,7 +38,15 @@ inline static int PS_y_out(int);
 
 /*###########################################################################*/
 void TGraph::print_to_ps(ostream & os, const string & filename) const {
-	RASSERT(dag_.size());
+	RASSERT(dag_.size() && ! first_ && last_ == dag_.size());
+
+// The drawing is laid out over every graph, so stream_write reloads them all.
+	RVector<TG> scratch(ArgPack::ap().stream_write ? dag_.size() : 0);
+	MAP(x, scratch.size()) {
+		graph(x, scratch[x]);
+	}
+
+	const RVector<TG> & dag = scratch.empty() ? dag_ : scratch;
 
 	X_min = Y_min = INT_MAX;
 	X_max = Y_max = 0;
@@ -49,24 +58,24 @@ void TGraph::print_to_ps(ostream & os, const string & filename) const {
 
 	int		fmaxw, fmaxh;
 	fmaxw = fmaxh = -1;
-	MAP(x, dag_.size()) {
-		fmaxw = max(fmaxw, dag_[x].max_w());
-		fmaxh = max(fmaxh, dag_[x].max_h());
+	MAP(x, dag.size()) {
+		fmaxw = max(fmaxw, dag[x].max_w());
+		fmaxh = max(fmaxh, dag[x].max_h());
 	}
 
 	// set font and scale
 	const double min_PS   = static_cast<double> (min(PSheight, PSwidth));
 	const double box_size = min_PS /
-				(1.0 + max(1, max(static_cast<int> (dag_.size() * fmaxw),
+				(1.0 + max(1, max(static_cast<int> (dag.size() * fmaxw),
 								  fmaxh)));
 	int fsize = static_cast<int> ( box_size / 4.0 );
 	os << "/Courier findfont " << fsize << " scalefont setfont\n";
 
 	// DRAW OBJECTS ...
-	i_PS_dag     (os, dag_, fsize);
-	i_PS_node    (os, dag_, fmaxw, fmaxh, fsize);
-	i_PS_arc     (os, dag_, fmaxw, fmaxh, fsize);
-	i_PS_deadline(os, dag_, fmaxw, fmaxh, fsize);
+	i_PS_dag     (os, dag, fsize);
+	i_PS_node    (os, dag, fmaxw, fmaxh, fsize);
+	i_PS_arc     (os, dag, fmaxw, fmaxh, fsize);
+	i_PS_deadline(os, dag, fmaxw, fmaxh, fsize);
 
 	int pad = max(1,2*fsize);
 	X_min -= pad;